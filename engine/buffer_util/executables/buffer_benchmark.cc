@@ -0,0 +1,457 @@
+// Latency and throughput benchmarks for the buffer_util cross-thread buffers.
+//
+// Each benchmark runs a producer and a consumer pinned according to a
+// ThreadPlacement and sweeps payload sizes from 64 B to 1 MB. A mutex-based
+// triple buffer is included as a baseline. The double buffer hands the old
+// front buffer back to the producer, so its producer waits for the consumer
+// to let go of it, as the buffer's contract requires.
+//
+// The FanOut benchmarks compare one LockFreeBroadcastBuffer against N
+// LockFreeTripleBuffers (one per reader) for 1 to kMaxFanOutReaders readers.
+//
+// bazel run -c opt //engine/buffer_util/executables:buffer_benchmark --
+//   --benchmark_filter=Read/triple
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "engine/buffer_util/executables/cpu_topology.h"
+#include "engine/buffer_util/lock_free_broadcast_buffer.h"
+#include "engine/buffer_util/lock_free_double_buffer.h"
+#include "engine/buffer_util/lock_free_triple_buffer.h"
+
+namespace gib {
+namespace {
+
+static constexpr size_t kCacheLine = 64;
+static constexpr size_t kWordsPerLine = kCacheLine / sizeof(uint64_t);
+static constexpr int kMaxFanOutReaders = 4;
+
+// Payload of `kBytes` bytes. The first word carries the publish timestamp so
+// the consumer can measure hand-off latency.
+template <size_t kBytes> struct Payload {
+  static_assert(kBytes % kCacheLine == 0, "Payload must be whole cache lines");
+  std::array<uint64_t, kBytes / sizeof(uint64_t)> words{};
+};
+
+inline uint64_t NowNsec() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+// Writes one word per cache line so the whole payload changes hands.
+template <size_t kBytes>
+inline void Fill(Payload<kBytes> &payload, const uint64_t value) {
+  for (size_t i = 0; i < payload.words.size(); i += kWordsPerLine) {
+    payload.words[i] = value;
+  }
+  payload.words[0] = NowNsec();
+}
+
+// Reads one word per cache line.
+template <size_t kBytes> inline uint64_t Touch(const Payload<kBytes> &payload) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < payload.words.size(); i += kWordsPerLine) {
+    sum += payload.words[i];
+  }
+  return sum;
+}
+
+// Mutex-based triple buffer with the same interface as the lock-free buffers.
+template <typename DataType> class MutexTripleBuffer {
+public:
+  std::pair<DataType &, bool> Read() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_) {
+      return {*front_buffer_, false};
+    }
+    std::swap(front_buffer_, middle_buffer_);
+    dirty_ = false;
+    return {*front_buffer_, true};
+  }
+
+  DataType &Write() { return *back_buffer_; }
+
+  void Commit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(back_buffer_, middle_buffer_);
+    dirty_ = true;
+  }
+
+private:
+  std::array<DataType, 3> buffers_{};
+  std::mutex mutex_;
+  bool dirty_{false};
+  DataType *back_buffer_{&buffers_[0]};
+  DataType *middle_buffer_{&buffers_[1]};
+  DataType *front_buffer_{&buffers_[2]};
+};
+
+// LockFreeDoubleBuffer plus the hand-shake its contract asks of the caller:
+// the buffer Commit() hands back may still be read, so the producer only
+// writes again once the consumer has called Read() since the last Commit().
+template <typename DataType> class HandshakeDoubleBuffer {
+public:
+  std::pair<DataType &, bool> Read() {
+    // Releases the reference returned by the previous Read().
+    reads_.fetch_add(1, std::memory_order_acq_rel);
+    return buffer_.Read();
+  }
+
+  // True once the buffer Write() returns is no longer read.
+  bool CanWrite() const {
+    return reads_.load(std::memory_order_acquire) != reads_at_commit_;
+  }
+
+  DataType &Write() { return buffer_.Write(); }
+
+  void Commit() {
+    buffer_.Commit();
+    // A read-modify-write after the swap: a Read() ordered after it sees the
+    // new front buffer, one ordered before it is waited for.
+    reads_at_commit_ = reads_.fetch_add(0, std::memory_order_acq_rel);
+  }
+
+private:
+  LockFreeDoubleBuffer<DataType> buffer_;
+  std::atomic<uint64_t> reads_{0};
+  // No Commit() yet, the back buffer is free.
+  uint64_t reads_at_commit_{~uint64_t{0}};
+};
+
+// Whether the producer may call Write(). Only the double buffer makes it wait.
+template <typename Buffer> bool CanWrite(const Buffer & /*buffer*/) {
+  return true;
+}
+template <typename DataType>
+bool CanWrite(const HandshakeDoubleBuffer<DataType> &buffer) {
+  return buffer.CanWrite();
+}
+
+// Runs `fn` on a thread pinned to `cpu` until Stop() is called. A negative
+// `cpu` leaves the thread unpinned.
+class PinnedThread {
+public:
+  template <typename Fn>
+  PinnedThread(const int cpu, const bool yield, Fn fn)
+      : thread_([this, cpu, yield, fn]() mutable {
+          if (cpu >= 0) {
+            PinCurrentThread(cpu);
+          }
+          while (!stop_.load(std::memory_order_relaxed)) {
+            fn();
+            if (yield) {
+              std::this_thread::yield();
+            }
+          }
+        }) {}
+  ~PinnedThread() { Stop(); }
+
+  void Stop() {
+    stop_.store(true, std::memory_order_relaxed);
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+// Resolves the placement in state.range(0) and pins the benchmark thread.
+// Returns the CPU for the background thread, or -1 if the benchmark was
+// skipped.
+int SetUpPlacement(benchmark::State &state, const bool benchmark_is_consumer) {
+  const auto placement = static_cast<ThreadPlacement>(state.range(0));
+  const auto cpus = CpusForPlacement(placement);
+  if (!cpus.has_value()) {
+    state.SkipWithError("CPU topology has no such placement");
+    return -1;
+  }
+  const auto [producer_cpu, consumer_cpu] = *cpus;
+  const int own_cpu = benchmark_is_consumer ? consumer_cpu : producer_cpu;
+  if (!PinCurrentThread(own_cpu)) {
+    state.SkipWithError("Failed to pin benchmark thread");
+    return -1;
+  }
+  state.SetLabel(ThreadPlacementToString(placement));
+  return benchmark_is_consumer ? producer_cpu : consumer_cpu;
+}
+
+// Consumer side: cost of Read() plus touching the payload while a pinned
+// producer keeps committing. Also reports how often Read() saw new data and
+// the producer-to-consumer hand-off latency.
+template <typename Buffer, size_t kBytes>
+void BM_Read(benchmark::State &state) {
+  const int producer_cpu =
+      SetUpPlacement(state, /*benchmark_is_consumer=*/true);
+  if (producer_cpu < 0) {
+    return;
+  }
+  const bool same_cpu =
+      static_cast<ThreadPlacement>(state.range(0)) == ThreadPlacement::SAME_CPU;
+
+  auto buffer = std::make_unique<Buffer>();
+  uint64_t seq = 0;
+  PinnedThread producer(producer_cpu, same_cpu, [&buffer, &seq]() {
+    if (!CanWrite(*buffer)) {
+      return;
+    }
+    Fill<kBytes>(buffer->Write(), ++seq);
+    buffer->Commit();
+  });
+
+  uint64_t fresh_reads = 0;
+  uint64_t handoff_nsec = 0;
+  for (auto _ : state) {
+    auto [payload, fresh] = buffer->Read();
+    benchmark::DoNotOptimize(Touch<kBytes>(payload));
+    if (fresh) {
+      ++fresh_reads;
+      handoff_nsec += NowNsec() - payload.words[0];
+    }
+  }
+  producer.Stop();
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kBytes));
+  state.counters["fresh_ratio"] = static_cast<double>(fresh_reads) /
+                                 static_cast<double>(state.iterations());
+  state.counters["handoff_ns"] =
+      fresh_reads == 0 ? 0.0
+                       : static_cast<double>(handoff_nsec) /
+                             static_cast<double>(fresh_reads);
+}
+
+// Producer side: cost of Write() plus filling the payload and Commit() while a
+// pinned consumer keeps reading. Includes waiting for the consumer where the
+// buffer requires it.
+template <typename Buffer, size_t kBytes>
+void BM_WriteCommit(benchmark::State &state) {
+  const int consumer_cpu =
+      SetUpPlacement(state, /*benchmark_is_consumer=*/false);
+  if (consumer_cpu < 0) {
+    return;
+  }
+  const bool same_cpu =
+      static_cast<ThreadPlacement>(state.range(0)) == ThreadPlacement::SAME_CPU;
+
+  auto buffer = std::make_unique<Buffer>();
+  uint64_t sink = 0;
+  PinnedThread consumer(consumer_cpu, same_cpu, [&buffer, &sink]() {
+    sink += Touch<kBytes>(buffer->Read().first);
+  });
+
+  uint64_t seq = 0;
+  for (auto _ : state) {
+    while (!CanWrite(*buffer)) {
+      if (same_cpu) {
+        std::this_thread::yield();
+      }
+    }
+    Fill<kBytes>(buffer->Write(), ++seq);
+    buffer->Commit();
+  }
+  consumer.Stop();
+  benchmark::DoNotOptimize(sink);
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kBytes));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// One broadcast buffer shared by all readers.
+template <size_t kBytes> class BroadcastFanOut {
+public:
+  explicit BroadcastFanOut(const int /*num_readers*/) {}
+
+  void Publish(const uint64_t seq) {
+    Fill<kBytes>(buffer_.Write(), seq);
+    buffer_.Commit();
+  }
+
+  // Returns the publish timestamp if `reader` saw new data, 0 otherwise.
+  uint64_t Read(const int /*reader*/, uint64_t &last_seq, uint64_t &sink) {
+    const auto handle = buffer_.Read();
+    sink += Touch<kBytes>(*handle);
+    if (handle.Sequence() == last_seq) {
+      return 0;
+    }
+    last_seq = handle.Sequence();
+    return handle->words[0];
+  }
+
+private:
+  LockFreeBroadcastBuffer<Payload<kBytes>, kMaxFanOutReaders> buffer_;
+};
+
+// One triple buffer per reader, the producer writes the state N times.
+template <size_t kBytes> class TripleFanOut {
+public:
+  explicit TripleFanOut(const int num_readers) {
+    for (int i = 0; i < num_readers; ++i) {
+      buffers_.push_back(std::make_unique<LockFreeTripleBuffer<Data>>());
+    }
+  }
+
+  void Publish(const uint64_t seq) {
+    for (auto &buffer : buffers_) {
+      Fill<kBytes>(buffer->Write(), seq);
+      buffer->Commit();
+    }
+  }
+
+  uint64_t Read(const int reader, uint64_t & /*last_seq*/, uint64_t &sink) {
+    auto [payload, fresh] = buffers_[reader]->Read();
+    sink += Touch<kBytes>(payload);
+    return fresh ? payload.words[0] : 0;
+  }
+
+private:
+  using Data = Payload<kBytes>;
+  std::vector<std::unique_ptr<LockFreeTripleBuffer<Data>>> buffers_;
+};
+
+// Spawns readers [first_reader, num_readers) on unpinned threads.
+template <typename FanOut>
+std::vector<std::unique_ptr<PinnedThread>>
+StartFanOutReaders(FanOut &fan_out, const int first_reader,
+                   const int num_readers, const bool yield) {
+  std::vector<std::unique_ptr<PinnedThread>> readers;
+  for (int reader = first_reader; reader < num_readers; ++reader) {
+    readers.push_back(std::make_unique<PinnedThread>(
+        -1, yield, [&fan_out, reader, last_seq = uint64_t{0}]() mutable {
+          uint64_t sink = 0;
+          fan_out.Read(reader, last_seq, sink);
+          benchmark::DoNotOptimize(sink);
+        }));
+  }
+  return readers;
+}
+
+// Consumer side with state.range(0) readers: cost of one reader's Read() while
+// a producer and the other readers run.
+template <typename FanOut, size_t kBytes>
+void BM_FanOutRead(benchmark::State &state) {
+  const int num_readers = static_cast<int>(state.range(0));
+  const bool yield = static_cast<int>(std::thread::hardware_concurrency()) <=
+                     num_readers;
+
+  auto fan_out = std::make_unique<FanOut>(num_readers);
+  uint64_t sink = 0;
+  uint64_t seq = 0;
+  PinnedThread producer(-1, yield, [&fan_out, &seq]() {
+    fan_out->Publish(++seq);
+  });
+  auto readers =
+      StartFanOutReaders(*fan_out, /*first_reader=*/1, num_readers, yield);
+
+  uint64_t last_seq = 0;
+  uint64_t fresh_reads = 0;
+  uint64_t handoff_nsec = 0;
+  for (auto _ : state) {
+    const uint64_t published_nsec = fan_out->Read(0, last_seq, sink);
+    if (published_nsec != 0) {
+      ++fresh_reads;
+      handoff_nsec += NowNsec() - published_nsec;
+    }
+  }
+  readers.clear();
+  producer.Stop();
+  benchmark::DoNotOptimize(sink);
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kBytes));
+  state.counters["fresh_ratio"] = static_cast<double>(fresh_reads) /
+                                 static_cast<double>(state.iterations());
+  state.counters["handoff_ns"] =
+      fresh_reads == 0 ? 0.0
+                       : static_cast<double>(handoff_nsec) /
+                             static_cast<double>(fresh_reads);
+}
+
+// Producer side with state.range(0) readers: cost of publishing one state.
+template <typename FanOut, size_t kBytes>
+void BM_FanOutWriteCommit(benchmark::State &state) {
+  const int num_readers = static_cast<int>(state.range(0));
+  const bool yield = static_cast<int>(std::thread::hardware_concurrency()) <=
+                     num_readers;
+
+  auto fan_out = std::make_unique<FanOut>(num_readers);
+  auto readers =
+      StartFanOutReaders(*fan_out, /*first_reader=*/0, num_readers, yield);
+
+  uint64_t seq = 0;
+  for (auto _ : state) {
+    fan_out->Publish(++seq);
+  }
+  readers.clear();
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kBytes));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template <typename Buffer, size_t kBytes>
+void RegisterFor(const std::string &buffer_name) {
+  const std::string suffix =
+      "/" + buffer_name + "/" + std::to_string(kBytes) + "B";
+  for (const auto &[name, fn] :
+       {std::make_pair("Read", &BM_Read<Buffer, kBytes>),
+        std::make_pair("WriteCommit", &BM_WriteCommit<Buffer, kBytes>)}) {
+    benchmark::RegisterBenchmark((name + suffix).c_str(), fn)
+        ->ArgName("placement")
+        ->DenseRange(static_cast<int>(ThreadPlacement::SAME_CPU),
+                     static_cast<int>(ThreadPlacement::CROSS_L3))
+        ->UseRealTime();
+  }
+}
+
+template <size_t kBytes> void RegisterPayload() {
+  using Data = Payload<kBytes>;
+  RegisterFor<HandshakeDoubleBuffer<Data>, kBytes>("double");
+  RegisterFor<LockFreeTripleBuffer<Data>, kBytes>("triple");
+  RegisterFor<MutexTripleBuffer<Data>, kBytes>("mutex");
+
+  const std::string suffix = "/" + std::to_string(kBytes) + "B";
+  for (const auto &[name, fn] :
+       {std::make_pair("FanOutRead/broadcast",
+                       &BM_FanOutRead<BroadcastFanOut<kBytes>, kBytes>),
+        std::make_pair("FanOutRead/triple",
+                       &BM_FanOutRead<TripleFanOut<kBytes>, kBytes>),
+        std::make_pair("FanOutWriteCommit/broadcast",
+                       &BM_FanOutWriteCommit<BroadcastFanOut<kBytes>, kBytes>),
+        std::make_pair("FanOutWriteCommit/triple",
+                       &BM_FanOutWriteCommit<TripleFanOut<kBytes>, kBytes>)}) {
+    benchmark::RegisterBenchmark((name + suffix).c_str(), fn)
+        ->ArgName("readers")
+        ->DenseRange(1, kMaxFanOutReaders)
+        ->UseRealTime();
+  }
+}
+
+} // namespace
+} // namespace gib
+
+int main(int argc, char **argv) {
+  gib::RegisterPayload<64>();
+  gib::RegisterPayload<4 * 1024>();
+  gib::RegisterPayload<64 * 1024>();
+  gib::RegisterPayload<1024 * 1024>();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
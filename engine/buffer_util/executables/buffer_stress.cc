@@ -0,0 +1,288 @@
+// Long-running stress test for the lock-free buffers. Meant to be run under
+// ThreadSanitizer:
+//
+// bazel run --config=tsan //engine/buffer_util/executables:buffer_stress --
+//   --seconds 600
+//
+// Every payload replicates a sequence number in each word, so a torn or
+// reordered read shows up as a mismatch even without TSAN.
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "engine/buffer_util/lock_free_broadcast_buffer.h"
+#include "engine/buffer_util/lock_free_spsc_ring.h"
+#include "engine/buffer_util/lock_free_triple_buffer.h"
+#include "third_party/concise_args/ConciseArgs.h"
+
+namespace gib {
+namespace {
+
+static constexpr size_t kPayloadWords = 512;
+static constexpr size_t kBroadcastReaders = 3;
+
+struct Payload {
+  std::array<uint64_t, kPayloadWords> words{};
+};
+
+struct StressResult {
+  uint64_t writes{0};
+  uint64_t reads{0};
+  uint64_t errors{0};
+};
+
+// Producer commits ever increasing sequence numbers, consumer checks that each
+// snapshot is consistent and never goes back in time.
+StressResult StressTripleBuffer(const std::chrono::seconds duration) {
+  auto buffer = std::make_unique<LockFreeTripleBuffer<Payload>>();
+  std::atomic<bool> stop{false};
+  StressResult result;
+
+  std::thread producer([&]() {
+    uint64_t seq = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      ++seq;
+      Payload &payload = buffer->Write();
+      for (uint64_t &word : payload.words) {
+        word = seq;
+      }
+      buffer->Commit();
+    }
+    result.writes = seq;
+  });
+
+  std::thread consumer([&]() {
+    uint64_t last_seq = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      const auto [payload, fresh] = buffer->Read();
+      ++result.reads;
+      const uint64_t seq = payload.words[0];
+      for (const uint64_t word : payload.words) {
+        if (word != seq) {
+          ++result.errors;
+          break;
+        }
+      }
+      if (seq < last_seq || (fresh && seq == last_seq && seq != 0)) {
+        ++result.errors;
+      }
+      last_seq = seq;
+    }
+  });
+
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+  producer.join();
+  consumer.join();
+  return result;
+}
+
+// Same checks as StressTripleBuffer with kBroadcastReaders concurrent readers.
+StressResult StressBroadcastBuffer(const std::chrono::seconds duration) {
+  auto buffer =
+      std::make_unique<LockFreeBroadcastBuffer<Payload, kBroadcastReaders>>();
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> errors{0};
+  StressResult result;
+
+  std::thread producer([&]() {
+    uint64_t seq = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      ++seq;
+      Payload &payload = buffer->Write();
+      for (uint64_t &word : payload.words) {
+        word = seq;
+      }
+      buffer->Commit();
+    }
+    result.writes = seq;
+  });
+
+  std::vector<std::thread> consumers;
+  for (size_t i = 0; i < kBroadcastReaders; ++i) {
+    consumers.emplace_back([&]() {
+      uint64_t last_seq = 0;
+      uint64_t local_reads = 0;
+      uint64_t local_errors = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        const auto handle = buffer->Read();
+        ++local_reads;
+        const uint64_t seq = handle->words[0];
+        for (const uint64_t word : handle->words) {
+          if (word != seq) {
+            ++local_errors;
+            break;
+          }
+        }
+        if (seq < last_seq || seq != handle.Sequence()) {
+          ++local_errors;
+        }
+        last_seq = seq;
+      }
+      reads.fetch_add(local_reads, std::memory_order_relaxed);
+      errors.fetch_add(local_errors, std::memory_order_relaxed);
+    });
+  }
+
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+  producer.join();
+  for (std::thread &consumer : consumers) {
+    consumer.join();
+  }
+  result.reads = reads.load();
+  result.errors = errors.load();
+  return result;
+}
+
+// Producer commits at ~10 kHz, consumers block in WaitForCommit(). While the
+// producer is running a wait must never time out, that would be a lost
+// wake-up, and a successful wait must be followed by a fresh Read().
+StressResult StressWaitForCommit(const std::chrono::seconds duration) {
+  static constexpr std::chrono::microseconds kCommitInterval{100};
+  static constexpr std::chrono::seconds kWaitTimeout{1};
+  auto triple = std::make_unique<LockFreeTripleBuffer<Payload>>();
+  auto broadcast =
+      std::make_unique<LockFreeBroadcastBuffer<Payload, kBroadcastReaders>>();
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> errors{0};
+  StressResult result;
+
+  std::thread producer([&]() {
+    uint64_t seq = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      ++seq;
+      triple->Write().words[0] = seq;
+      triple->Commit();
+      broadcast->Write().words[0] = seq;
+      broadcast->Commit();
+      std::this_thread::sleep_for(kCommitInterval);
+    }
+    result.writes = seq;
+  });
+
+  std::vector<std::thread> consumers;
+  consumers.emplace_back([&]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+      const bool committed = triple->WaitForCommit(kWaitTimeout);
+      if (stop.load(std::memory_order_relaxed)) {
+        break;
+      }
+      reads.fetch_add(1, std::memory_order_relaxed);
+      if (!committed || !triple->Read().second) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  });
+  for (size_t i = 0; i < kBroadcastReaders; ++i) {
+    consumers.emplace_back([&]() {
+      uint64_t last_seq = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        const bool committed = broadcast->WaitForCommit(last_seq, kWaitTimeout);
+        if (stop.load(std::memory_order_relaxed)) {
+          break;
+        }
+        reads.fetch_add(1, std::memory_order_relaxed);
+        const auto handle = broadcast->Read();
+        if (!committed || handle.Sequence() == last_seq) {
+          errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        last_seq = handle.Sequence();
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+  producer.join();
+  for (std::thread &consumer : consumers) {
+    consumer.join();
+  }
+  result.reads = reads.load();
+  result.errors = errors.load();
+  return result;
+}
+
+// Every pushed element must be popped exactly once and in order.
+StressResult StressSpscRing(const std::chrono::seconds duration) {
+  auto ring = std::make_unique<LockFreeSpscRing<uint64_t, 1024>>();
+  std::atomic<bool> stop{false};
+  std::atomic<bool> producer_done{false};
+  StressResult result;
+
+  std::thread producer([&]() {
+    uint64_t seq = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (ring->TryPush(seq + 1)) {
+        ++seq;
+      }
+    }
+    result.writes = seq;
+    producer_done.store(true, std::memory_order_release);
+  });
+
+  std::thread consumer([&]() {
+    uint64_t expected = 1;
+    uint64_t value = 0;
+    while (true) {
+      if (ring->TryPop(value)) {
+        ++result.reads;
+        if (value != expected) {
+          ++result.errors;
+        }
+        expected = value + 1;
+      } else if (producer_done.load(std::memory_order_acquire) &&
+                 ring->SizeApprox() == 0) {
+        break;
+      }
+    }
+  });
+
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+  producer.join();
+  consumer.join();
+  if (result.reads != result.writes) {
+    ++result.errors;
+  }
+  return result;
+}
+
+void Report(const char *name, const StressResult &result) {
+  std::cout << name << ": writes=" << result.writes
+            << " reads=" << result.reads << " errors=" << result.errors
+            << std::endl;
+}
+
+} // namespace
+} // namespace gib
+
+int main(int argc, char **argv) {
+  int seconds = 10;
+  ConciseArgs args(argc, argv, "",
+                   "Stress test for engine/buffer_util, run under TSAN.");
+  args.add(seconds, "s", "seconds", "Seconds to run each stress test for.");
+  args.parse();
+
+  const std::chrono::seconds duration(seconds);
+  const gib::StressResult triple = gib::StressTripleBuffer(duration);
+  gib::Report("LockFreeTripleBuffer", triple);
+  const gib::StressResult broadcast = gib::StressBroadcastBuffer(duration);
+  gib::Report("LockFreeBroadcastBuffer", broadcast);
+  const gib::StressResult wait = gib::StressWaitForCommit(duration);
+  gib::Report("WaitForCommit", wait);
+  const gib::StressResult ring = gib::StressSpscRing(duration);
+  gib::Report("LockFreeSpscRing", ring);
+
+  return (triple.errors == 0 && broadcast.errors == 0 && wait.errors == 0 &&
+          ring.errors == 0)
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE;
+}
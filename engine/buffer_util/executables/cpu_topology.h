@@ -0,0 +1,148 @@
+#pragma once
+
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace gib {
+
+// Where the producer and consumer threads are pinned relative to each other.
+enum class ThreadPlacement : int {
+  // Both threads on the same logical CPU.
+  SAME_CPU = 0,
+  // Hyper-thread siblings, i.e. same physical core.
+  SMT_SIBLING,
+  // Different physical cores that share the last level cache.
+  SAME_L3,
+  // Cores in different last level cache domains (CCX/socket).
+  CROSS_L3,
+};
+
+inline const char *ThreadPlacementToString(const ThreadPlacement placement) {
+  switch (placement) {
+  case ThreadPlacement::SAME_CPU:
+    return "same_cpu";
+  case ThreadPlacement::SMT_SIBLING:
+    return "smt_sibling";
+  case ThreadPlacement::SAME_L3:
+    return "same_l3";
+  case ThreadPlacement::CROSS_L3:
+    return "cross_l3";
+  }
+  return "unknown";
+}
+
+// Parses a sysfs cpu list, i.e., "0-3,8,10-11".
+inline std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    const size_t dash = range.find('-');
+    const int first = std::stoi(range.substr(0, dash));
+    const int last =
+        dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// Reads the first line of a sysfs file, empty if it doesn't exist.
+inline std::string ReadSysfsLine(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+inline std::vector<int> SmtSiblings(const int cpu) {
+  return ParseCpuList(ReadSysfsLine(
+      "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+      "/topology/thread_siblings_list"));
+}
+
+inline std::vector<int> L3Siblings(const int cpu) {
+  return ParseCpuList(
+      ReadSysfsLine("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                    "/cache/index3/shared_cpu_list"));
+}
+
+inline bool Contains(const std::vector<int> &cpus, const int cpu) {
+  for (const int other : cpus) {
+    if (other == cpu) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the (producer, consumer) CPU pair for the given placement, or
+// nullopt if the machine doesn't have such a pair.
+inline std::optional<std::pair<int, int>>
+CpusForPlacement(const ThreadPlacement placement) {
+  const int num_cpus = static_cast<int>(std::thread::hardware_concurrency());
+  constexpr int kFirstCpu = 0;
+  const std::vector<int> smt = SmtSiblings(kFirstCpu);
+  const std::vector<int> l3 = L3Siblings(kFirstCpu);
+
+  switch (placement) {
+  case ThreadPlacement::SAME_CPU:
+    return std::make_pair(kFirstCpu, kFirstCpu);
+  case ThreadPlacement::SMT_SIBLING:
+    for (const int cpu : smt) {
+      if (cpu != kFirstCpu) {
+        return std::make_pair(kFirstCpu, cpu);
+      }
+    }
+    break;
+  case ThreadPlacement::SAME_L3:
+    for (const int cpu : l3) {
+      if (cpu != kFirstCpu && !Contains(smt, cpu)) {
+        return std::make_pair(kFirstCpu, cpu);
+      }
+    }
+    break;
+  case ThreadPlacement::CROSS_L3:
+    if (l3.empty()) {
+      break;
+    }
+    for (int cpu = 0; cpu < num_cpus; ++cpu) {
+      if (!Contains(l3, cpu)) {
+        return std::make_pair(kFirstCpu, cpu);
+      }
+    }
+    break;
+  }
+  return std::nullopt;
+}
+
+// Pins the calling thread to `cpu`. Returns false if pinning isn't supported
+// or failed.
+inline bool PinCurrentThread(const int cpu) {
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+} // namespace gib
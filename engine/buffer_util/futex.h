@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace gib {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "Futex word must be a plain 32-bit integer");
+
+// Blocks while `word` holds `expected`, for at most `timeout`. May return
+// early (spuriously), callers must re-check their condition.
+//
+// Uses a futex on Linux. Elsewhere falls back to polling with short sleeps,
+// which adds up to kFutexPollInterval of latency.
+inline void FutexWait(std::atomic<uint32_t> &word, const uint32_t expected,
+                      const std::chrono::nanoseconds timeout) {
+#ifdef __linux__
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(timeout.count() / 1'000'000'000);
+  ts.tv_nsec = static_cast<long>(timeout.count() % 1'000'000'000);
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE,
+          expected, &ts, nullptr, 0);
+#else
+  static constexpr std::chrono::microseconds kFutexPollInterval{100};
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (word.load(std::memory_order_acquire) == expected &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(
+        std::min<std::chrono::nanoseconds>(kFutexPollInterval, timeout));
+  }
+#endif
+}
+
+// Wakes all threads blocked in FutexWait() on `word`.
+inline void FutexWakeAll(std::atomic<uint32_t> &word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE,
+          INT32_MAX, nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+
+} // namespace gib
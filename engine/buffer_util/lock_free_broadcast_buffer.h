@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "engine/buffer_util/futex.h"
+
+namespace gib {
+
+// Lock-free single producer-multi consumer broadcast buffer.
+//
+// Holds kMaxReaders + 2 slots, each with a reader pin count. Readers pin the
+// latest published slot and read it in place, so the state is never copied per
+// reader and the producer never waits: there is always at least one slot that
+// is neither published nor pinned.
+//
+// Each consumer may hold at most one ReadHandle at a time, and at most
+// kMaxReaders consumers may read concurrently.
+template <typename DataType, size_t kMaxReaders> class LockFreeBroadcastBuffer {
+  static_assert(kMaxReaders > 0, "Need at least one reader");
+  static constexpr size_t kNumSlots = kMaxReaders + 2;
+
+  struct Slot;
+
+public:
+  // Pins a published slot for as long as it is alive.
+  class ReadHandle {
+  public:
+    ReadHandle(ReadHandle &&other) noexcept
+        : slot_(other.slot_), sequence_(other.sequence_) {
+      other.slot_ = nullptr;
+    }
+    ReadHandle &operator=(ReadHandle &&other) noexcept {
+      if (this != &other) {
+        Release();
+        slot_ = other.slot_;
+        sequence_ = other.sequence_;
+        other.slot_ = nullptr;
+      }
+      return *this;
+    }
+    ReadHandle(const ReadHandle &) = delete;
+    ReadHandle &operator=(const ReadHandle &) = delete;
+    ~ReadHandle() { Release(); }
+
+    const DataType &operator*() const { return slot_->data; }
+    const DataType *operator->() const { return &slot_->data; }
+
+    // Number of Commit() calls before this snapshot was published. Readers can
+    // compare it with the last seen value to check for new data.
+    [[nodiscard]] uint64_t Sequence() const { return sequence_; }
+
+  private:
+    friend class LockFreeBroadcastBuffer;
+    ReadHandle(Slot *slot, const uint64_t sequence)
+        : slot_(slot), sequence_(sequence) {}
+
+    void Release() {
+      if (slot_ != nullptr) {
+        slot_->readers.fetch_sub(1, std::memory_order_release);
+        slot_ = nullptr;
+      }
+    }
+
+    Slot *slot_;
+    uint64_t sequence_;
+  };
+
+  // All slots will be default initialized.
+  LockFreeBroadcastBuffer() = default;
+
+  // Consumer: pins and returns the latest published snapshot.
+  ReadHandle Read() {
+    while (true) {
+      const uint64_t published = published_.load(std::memory_order_seq_cst);
+      Slot &slot = slots_[published & kIndexMask];
+      slot.readers.fetch_add(1, std::memory_order_seq_cst);
+      // The producer never reuses the published slot, so if it is still
+      // published after pinning, the pin is visible to the producer before it
+      // can pick this slot again.
+      if (published_.load(std::memory_order_seq_cst) == published) {
+        return ReadHandle(&slot, published >> kIndexBits);
+      }
+      slot.readers.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // Consumer: blocks until a snapshot newer than `last_sequence` (see
+  // ReadHandle::Sequence()) is published, or `timeout` expires. Returns true if
+  // there is a newer snapshot.
+  bool WaitForCommit(const uint64_t last_sequence,
+                     const std::chrono::nanoseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    bool fresh = false;
+    while (true) {
+      const uint32_t wake_seq = wake_seq_.load(std::memory_order_acquire);
+      if ((published_.load(std::memory_order_seq_cst) >> kIndexBits) !=
+          last_sequence) {
+        fresh = true;
+        break;
+      }
+      const auto remaining = deadline - std::chrono::steady_clock::now();
+      if (remaining <= std::chrono::nanoseconds::zero()) {
+        break;
+      }
+      FutexWait(wake_seq_, wake_seq,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    remaining));
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return fresh;
+  }
+
+  // Producer: returns reference to a slot no reader can see. It holds an older
+  // snapshot, so the producer must fill the whole state before Commit().
+  DataType &Write() { return slots_[back_index_].data; }
+
+  // Producer: publishes the slot returned by Write() and picks a free slot for
+  // the next write.
+  void Commit() {
+    ++sequence_;
+    published_.store((sequence_ << kIndexBits) | back_index_,
+                     std::memory_order_seq_cst);
+    // Pairs with the waiter count increment in WaitForCommit(): either the
+    // waiter sees the new sequence or we see the waiter.
+    if (waiters_.load(std::memory_order_seq_cst) != 0) {
+      wake_seq_.fetch_add(1, std::memory_order_release);
+      FutexWakeAll(wake_seq_);
+    }
+    const size_t published_index = back_index_;
+    for (size_t i = 1; i < kNumSlots; ++i) {
+      const size_t index = (published_index + i) % kNumSlots;
+      if (slots_[index].readers.load(std::memory_order_seq_cst) == 0) {
+        back_index_ = index;
+        return;
+      }
+    }
+    // Unreachable as long as at most kMaxReaders consumers hold a handle.
+    __builtin_trap();
+  }
+
+private:
+  static constexpr size_t kNoSharing = 64; // cache-line size.
+  static constexpr uint64_t kIndexBits = 8;
+  static constexpr uint64_t kIndexMask = (uint64_t{1} << kIndexBits) - 1;
+  static_assert(kNumSlots <= kIndexMask + 1, "Too many readers");
+
+  struct alignas(kNoSharing) Slot {
+    std::atomic<uint32_t> readers{0};
+    DataType data{};
+  };
+
+  std::array<Slot, kNumSlots> slots_;
+
+  alignas(kNoSharing) std::atomic<uint64_t> published_{0};
+
+  // Consumers blocked in WaitForCommit(), and the word they block on.
+  alignas(kNoSharing) std::atomic<uint32_t> waiters_{0};
+  std::atomic<uint32_t> wake_seq_{0};
+
+  // Producer-owned.
+  alignas(kNoSharing) size_t back_index_{1};
+  uint64_t sequence_{0};
+};
+
+} // namespace gib
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <memory>
+#include <utility>
 
 namespace gib {
 
@@ -24,16 +27,15 @@ public:
 
   // Returns reference to the latest front buffer.
   std::pair<DataType &, bool> Read() {
-    // If there's a new buffer recently written -> will swap buffers and return
-    // the latest value. Otherwise, will return stale value.
-    uintptr_t dirty_ptr = back_buffer_.load(std::memory_order_relaxed);
-    if ((dirty_ptr & kDirtyBit) == 0) {
-      return {*front_buffer_, false};
+    // If there's a new buffer recently written -> clears the dirty bit and
+    // returns the latest value. Otherwise, will return stale value.
+    uintptr_t front_ptr = front_buffer_.load(std::memory_order_acquire);
+    if ((front_ptr & kDirtyBit) == 0) {
+      return {*reinterpret_cast<DataType *>(front_ptr), false};
     }
-    uintptr_t prev = back_buffer_.exchange(
-        reinterpret_cast<uintptr_t>(front_buffer_), std::memory_order_acq_rel);
-    front_buffer_ = reinterpret_cast<DataType *>(prev & kDirtyBitMask);
-    return {*front_buffer_, true};
+    front_ptr =
+        front_buffer_.fetch_and(kDirtyBitMask, std::memory_order_acq_rel);
+    return {*reinterpret_cast<DataType *>(front_ptr & kDirtyBitMask), true};
   }
 
   // Returns reference to back buffer, producer can use it to fill the buffer.
@@ -43,10 +45,12 @@ public:
     return *back_buffer_;
   }
 
-  // Propagates pending changes from the back buffer to the front buffer.
+  // Swaps the back buffer with the front buffer.
   void Commit() {
-    // The next read will get those changes unless the writer is faster and will
-    // overwrite those changes before the next Read() call.
+    // With only two buffers the old front buffer is handed back to the
+    // producer, so the consumer must be done with the reference returned by
+    // Read() before the producer writes again. Use LockFreeTripleBuffer when
+    // producer and consumer run at unrelated rates.
     const uintptr_t dirty_ptr =
         kDirtyBit | reinterpret_cast<uintptr_t>(back_buffer_);
     uintptr_t prev =
@@ -66,10 +70,9 @@ private:
 
   std::array<Buffer, 2> buffers_;
 
-  std::atomic<uintptr_t> back_buffer_{
-      reinterpret_cast<uintptr_t>(&buffers_[0].data)};
   std::atomic<uintptr_t> front_buffer_{
       reinterpret_cast<uintptr_t>(&buffers_[1].data)};
+  alignas(kNoSharing) DataType *back_buffer_{&buffers_[0].data};
 };
 
 } // namespace gib
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace gib {
+
+// Lock-free single producer-single consumer bounded FIFO. Capacity must be a
+// power of two. Unlike the double/triple buffers, no element is ever
+// overwritten: every pushed element is popped exactly once, in order.
+template <typename DataType, size_t kCapacity> class LockFreeSpscRing {
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+public:
+  LockFreeSpscRing() = default;
+
+  // Producer: appends a copy of `data`. Returns false if the ring is full.
+  bool TryPush(const DataType &data) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == kCapacity) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == kCapacity) {
+        return false;
+      }
+    }
+    slots_[tail & kMask] = data;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: returns the oldest element without removing it, or nullptr if
+  // the ring is empty. The pointer stays valid until Pop().
+  const DataType *Front() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return nullptr;
+      }
+    }
+    return &slots_[head & kMask];
+  }
+
+  // Consumer: removes the element returned by Front(). Must only be called
+  // after Front() returned non-null.
+  void Pop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  // Consumer: pops the oldest element into `data`. Returns false if the ring is
+  // empty.
+  bool TryPop(DataType &data) {
+    const DataType *front = Front();
+    if (front == nullptr) {
+      return false;
+    }
+    data = *front;
+    Pop();
+    return true;
+  }
+
+  // Approximate number of queued elements. Exact only when called from the
+  // producer or consumer with the other side idle.
+  [[nodiscard]] size_t SizeApprox() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t Capacity() { return kCapacity; }
+
+private:
+  static constexpr size_t kNoSharing = 64; // cache-line size.
+  static constexpr size_t kMask = kCapacity - 1;
+
+  std::array<DataType, kCapacity> slots_{};
+
+  // Consumer-owned.
+  alignas(kNoSharing) std::atomic<size_t> head_{0};
+  size_t cached_tail_{0};
+
+  // Producer-owned.
+  alignas(kNoSharing) std::atomic<size_t> tail_{0};
+  size_t cached_head_{0};
+};
+
+} // namespace gib
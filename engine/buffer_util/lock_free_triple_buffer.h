@@ -1,7 +1,13 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <utility>
+
+#include "engine/buffer_util/futex.h"
 
 namespace gib {
 
@@ -34,10 +40,40 @@ public:
     }
     uintptr_t prev = middle_buffer_.exchange(
         reinterpret_cast<uintptr_t>(front_buffer_), std::memory_order_acq_rel);
-    front_buffer_ = reinterpret_cast<DataType *>(prev & kDirtyBitMask);
+    front_buffer_ = reinterpret_cast<DataType *>(prev & kPointerMask);
     return {*front_buffer_, true};
   }
 
+  // Blocks until there is a commit the consumer hasn't read yet, or `timeout`
+  // expires. Returns true if the next Read() will return new data.
+  //
+  // The waiting flag lives in the same word Commit() already exchanges, so the
+  // producer only pays for a wake-up syscall when the consumer is blocked.
+  bool WaitForCommit(const std::chrono::nanoseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+      const uint32_t wake_seq = wake_seq_.load(std::memory_order_acquire);
+      uintptr_t middle_ptr = middle_buffer_.load(std::memory_order_acquire);
+      if ((middle_ptr & kDirtyBit) != 0) {
+        return true;
+      }
+      const auto remaining = deadline - std::chrono::steady_clock::now();
+      if (remaining <= std::chrono::nanoseconds::zero()) {
+        return false;
+      }
+      // Fails if the producer committed in between, re-check in that case.
+      if ((middle_ptr & kWaitingBit) == 0 &&
+          !middle_buffer_.compare_exchange_strong(
+              middle_ptr, middle_ptr | kWaitingBit,
+              std::memory_order_acq_rel)) {
+        continue;
+      }
+      FutexWait(wake_seq_, wake_seq,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    remaining));
+    }
+  }
+
   // Returns reference to back buffer, producer can use it to fill the buffer.
   DataType &Write() {
     // Once finished filling the buffer Commit() must be called to propagate
@@ -52,15 +88,21 @@ public:
     const uintptr_t dirty_ptr =
         kDirtyBit | reinterpret_cast<uintptr_t>(back_buffer_);
     uintptr_t prev =
-        middle_buffer_.exchange(dirty_ptr, std::memory_order_acq_rel) &
-        kDirtyBitMask;
-    back_buffer_ = reinterpret_cast<DataType *>(prev);
+        middle_buffer_.exchange(dirty_ptr, std::memory_order_acq_rel);
+    back_buffer_ = reinterpret_cast<DataType *>(prev & kPointerMask);
+    if ((prev & kWaitingBit) != 0) {
+      // Consumer is blocked in WaitForCommit().
+      wake_seq_.fetch_add(1, std::memory_order_release);
+      FutexWakeAll(wake_seq_);
+    }
   }
 
 private:
   static constexpr size_t kNoSharing = 64; // cache-line size.
   static constexpr uintptr_t kDirtyBit = 1;
-  static constexpr uintptr_t kDirtyBitMask = ~uintptr_t() ^ kDirtyBit;
+  // Set by a consumer blocked in WaitForCommit().
+  static constexpr uintptr_t kWaitingBit = 2;
+  static constexpr uintptr_t kPointerMask = ~(kDirtyBit | kWaitingBit);
 
   struct alignas(kNoSharing) Buffer {
     DataType data{};
@@ -73,6 +115,9 @@ private:
   alignas(kNoSharing) DataType *back_buffer_{&buffers_[0].data};
 
   alignas(kNoSharing) DataType *front_buffer_{&buffers_[2].data};
+
+  // Bumped by the producer to wake a consumer blocked in WaitForCommit().
+  alignas(kNoSharing) std::atomic<uint32_t> wake_seq_{0};
 };
 
 } // namespace gib
\ No newline at end of file
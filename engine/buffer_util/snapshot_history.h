@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "engine/buffer_util/lock_free_triple_buffer.h"
+#include "util/time/time.h"
+
+namespace gib {
+
+// Published state and the time it belongs to.
+template <typename DataType> struct TimedSnapshot {
+  time_util::TimePoint time{};
+  DataType data{};
+};
+
+// True if `DataType Interpolate(const DataType &, const DataType &, float)` is
+// found for DataType (usually via ADL next to the type).
+template <typename DataType, typename = void>
+struct IsInterpolatable : std::false_type {};
+template <typename DataType>
+struct IsInterpolatable<
+    DataType, std::void_t<decltype(Interpolate(std::declval<const DataType &>(),
+                                               std::declval<const DataType &>(),
+                                               0.f))>> : std::true_type {};
+template <typename DataType>
+inline constexpr bool kIsInterpolatable = IsInterpolatable<DataType>::value;
+
+// Single producer-single consumer history of the last kDepth published
+// snapshots.
+//
+// The producer publishes timestamped snapshots through a LockFreeTripleBuffer.
+// The consumer pulls them into a private ring with Update() and samples the two
+// snapshots around a point in time with At(), e.g. `now - render_delay` to
+// render smooth motion from a lower rate simulation.
+template <typename DataType, size_t kDepth = 3> class SnapshotHistory {
+  static_assert(kDepth >= 2, "Need at least two snapshots to interpolate");
+
+public:
+  // The two snapshots around a point in time. `alpha` is in [0, 1], 0 being
+  // `from` and 1 being `to`.
+  struct Sample {
+    const DataType *from;
+    const DataType *to;
+    float alpha;
+  };
+
+  SnapshotHistory() = default;
+
+  // Producer: returns the snapshot to fill.
+  DataType &Write() { return buffer_.Write().data; }
+
+  // Producer: publishes the snapshot returned by Write() as the state at
+  // `time`. Times must be increasing.
+  void Commit(const time_util::TimePoint time) {
+    buffer_.Write().time = time;
+    buffer_.Commit();
+  }
+
+  // Consumer: pulls the newest published snapshot into the history. Returns
+  // true if there was one. Snapshots committed between two Update() calls but
+  // overwritten before being read are skipped, At() interpolates across the
+  // gap.
+  bool Update() {
+    auto [snapshot, fresh] = buffer_.Read();
+    if (!fresh) {
+      return false;
+    }
+    newest_ = (newest_ + 1) % kDepth;
+    history_[newest_] = snapshot;
+    size_ = std::min(size_ + 1, kDepth);
+    return true;
+  }
+
+  // Consumer: returns the snapshots around `time`. Clamps to the oldest or
+  // newest snapshot if `time` is outside the history (no extrapolation).
+  // Returns nullopt if nothing was published yet.
+  [[nodiscard]] std::optional<Sample>
+  At(const time_util::TimePoint time) const {
+    if (size_ == 0) {
+      return std::nullopt;
+    }
+    const TimedSnapshot<DataType> &newest = Get(0);
+    if (time >= newest.time) {
+      return Sample{&newest.data, &newest.data, 1.f};
+    }
+    for (size_t age = 1; age < size_; ++age) {
+      const TimedSnapshot<DataType> &from = Get(age);
+      if (time < from.time) {
+        continue;
+      }
+      const TimedSnapshot<DataType> &to = Get(age - 1);
+      const float span = time_util::to_seconds(to.time - from.time);
+      const float alpha =
+          span > 0.f ? time_util::to_seconds(time - from.time) / span : 1.f;
+      return Sample{&from.data, &to.data, std::clamp(alpha, 0.f, 1.f)};
+    }
+    const TimedSnapshot<DataType> &oldest = Get(size_ - 1);
+    return Sample{&oldest.data, &oldest.data, 0.f};
+  }
+
+  // Consumer: interpolated state at `time`, see At(). Requires an
+  // Interpolate() overload for DataType.
+  [[nodiscard]] std::optional<DataType>
+  InterpolateAt(const time_util::TimePoint time) const {
+    static_assert(kIsInterpolatable<DataType>,
+                  "DataType needs an Interpolate(a, b, alpha) overload");
+    const std::optional<Sample> sample = At(time);
+    if (!sample.has_value()) {
+      return std::nullopt;
+    }
+    return Interpolate(*sample->from, *sample->to, sample->alpha);
+  }
+
+  // Consumer: newest pulled snapshot. Must not be called before the first
+  // successful Update().
+  [[nodiscard]] const TimedSnapshot<DataType> &Newest() const {
+    return Get(0);
+  }
+
+  // Consumer: number of snapshots in the history.
+  [[nodiscard]] size_t Size() const { return size_; }
+
+private:
+  // Snapshot `age` commits older than the newest one.
+  const TimedSnapshot<DataType> &Get(const size_t age) const {
+    return history_[(newest_ + kDepth - age) % kDepth];
+  }
+
+  LockFreeTripleBuffer<TimedSnapshot<DataType>> buffer_;
+
+  // Consumer-owned.
+  std::array<TimedSnapshot<DataType>, kDepth> history_{};
+  size_t newest_{0};
+  size_t size_{0};
+};
+
+} // namespace gib
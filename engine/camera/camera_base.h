@@ -17,6 +17,25 @@ namespace gib {
 static constexpr float kFovMin = 45.0f;
 static constexpr float kFovMax = 100.0f;
 
+// Plain copy of the camera state, e.g. to publish it from the simulation thread
+// and interpolate it on the render thread.
+struct CameraState {
+  glm::vec3 position{0.f, 0.f, 3.f};
+  float yaw{-90.f};
+  float pitch{0.f};
+  float fov{kFovMax};
+};
+
+inline CameraState Interpolate(const CameraState &from, const CameraState &to,
+                               const float alpha) {
+  CameraState state;
+  state.position = glm::mix(from.position, to.position, alpha);
+  state.yaw = glm::mix(from.yaw, to.yaw, alpha);
+  state.pitch = glm::mix(from.pitch, to.pitch, alpha);
+  state.fov = glm::mix(from.fov, to.fov, alpha);
+  return state;
+}
+
 // Base camera. Derived class is responsible for implementing ProcessInputImpl()
 // that updates internal state which influences the projection matrix.
 template <typename CameraUpdateModel> class BaseCamera {
@@ -42,6 +61,22 @@ public:
   [[nodiscard]] glm::mat4 GetViewMatrix() const noexcept {
     return glm::lookAt(position_, position_ + front_, up_);
   }
+  [[nodiscard]] CameraState State() const noexcept {
+    CameraState state;
+    state.position = position_;
+    state.yaw = yaw_;
+    state.pitch = pitch_;
+    state.fov = fov_.Get();
+    return state;
+  }
+  // Overwrites the camera with `state`, e.g. an interpolated snapshot.
+  void SetState(const CameraState &state) noexcept {
+    position_ = state.position;
+    yaw_ = state.yaw;
+    pitch_ = state.pitch;
+    fov_.Set(state.fov);
+    static_cast<CameraUpdateModel *>(this)->UpdateVectors();
+  }
   void ToggleEnableCameraUpdate(const bool &enable) noexcept {
     update_enabled_ = enable;
   }
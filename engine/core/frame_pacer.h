@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <thread>
+
+#include "engine/core/frame_util.h"
+#include "engine/core/types.h"
+#include "third_party/glad/glad.h"
+#include "third_party/imgui/imgui.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+#include "util/time/time.h"
+
+namespace gib {
+
+// Number of frames the CPU/GPU cost prediction looks back.
+static constexpr size_t kFrameCostWindow = 16;
+// Extra time budgeted on top of the predicted frame cost.
+static constexpr float kDefaultPacingMarginMs = 1.f;
+// Range and default for the number of frames the CPU may run ahead of the GPU.
+static constexpr int kMinFramesInFlight = 1;
+static constexpr int kMaxFramesInFlight = 3;
+static constexpr int kDefaultFramesInFlight = 2;
+// Upper bound for blocking on a frame fence, guards against a hung GPU.
+static constexpr time_util::DurationUsec kFrameFenceTimeout{100'000};
+
+// Paces the render loop to reduce input-to-present latency.
+//
+// Every frame is tagged with a GL fence, used to know when the GPU is done
+// with it. The GPU cost of a frame is measured separately with GL_TIMESTAMP
+// queries (GpuProfiler) and passed to RecordGpuTime(): a fence is only seen
+// when the CPU next checks it, often after the swap blocked on vsync, so the
+// time until then over-estimates the GPU work. In low latency mode
+// BeginFrame() first waits for the GPU to finish all queued frames (so the
+// driver queue stays empty) and then sleeps until just before the predicted
+// deadline, i.e. the next vblank minus the worst recent CPU + GPU frame cost.
+// Input is polled after the sleep, so the frame is drawn with the freshest
+// input possible.
+//
+// Independently of the mode, LimitFramesInFlight() caps how many frames the
+// driver may queue, which bounds latency when the GPU is the bottleneck.
+//
+// Vblank times are approximated by the time glfwSwapBuffers() returns.
+//
+// If `fps_tracker` is set, per-frame CPU and GPU costs are also recorded into
+// its percentile histograms.
+class FramePacer {
+public:
+  explicit FramePacer(const float refresh_rate_hz,
+                      FpsTracker *fps_tracker = nullptr)
+      : fps_tracker_(fps_tracker) {
+    SetRefreshRate(refresh_rate_hz);
+  }
+  ~FramePacer() = default;
+
+  void ToggleLowLatencyMode(const bool enable) {
+    if (low_latency_ == enable) {
+      return;
+    }
+    low_latency_ = enable;
+    DEBUG("Low latency mode enabled: {}", enable);
+  }
+  [[nodiscard]] bool IsLowLatencyMode() const { return low_latency_; }
+
+  // Without vsync there is no deadline to pace to, low latency mode then only
+  // keeps the driver queue empty.
+  void ToggleVsync(const bool enable_vsync) { vsync_ = enable_vsync; }
+
+  void SetRefreshRate(const float refresh_rate_hz) {
+    ASSERT(refresh_rate_hz > 0.f, "Refresh rate must be > 0, got {}",
+           refresh_rate_hz);
+    refresh_interval_ = time_util::seconds_to_usec(1.f / refresh_rate_hz);
+  }
+
+  // Call at the start of the frame, before polling input.
+  void BeginFrame() {
+    PROFILE_SCOPE_N("FramePacer::BeginFrame");
+    RetireFrames(/*block=*/low_latency_);
+    sleep_usec_ = 0.f;
+    if (!low_latency_ || !vsync_) {
+      return;
+    }
+
+    const auto predicted_cost = PredictedFrameCost();
+    const time_util::TimePoint now = time_util::now();
+    time_util::TimePoint deadline = last_present_ + refresh_interval_;
+    while (deadline < now + predicted_cost) {
+      deadline += refresh_interval_;
+    }
+    const time_util::TimePoint wake_up = deadline - predicted_cost;
+    if (wake_up > now) {
+      PROFILE_SCOPE_N("FramePacer::Sleep");
+      std::this_thread::sleep_until(wake_up);
+      sleep_usec_ = static_cast<float>(time_util::elapsed_usec(now).count());
+    }
+  }
+
+  // Call right after glfwPollEvents().
+  void MarkInputSampled() { input_time_ = time_util::now(); }
+
+  // Call after the last draw call of the frame, before swapping buffers.
+  void EndFrame() {
+    PendingFrame frame;
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.input_time = input_time_;
+    frame.submit_time = time_util::now();
+    pending_.push_back(frame);
+    const auto cpu_cost =
+        time_util::elapsed_usec(input_time_, frame.submit_time);
+    cpu_cost_.Record(cpu_cost);
+    if (fps_tracker_ != nullptr) {
+      fps_tracker_->RecordCpuTime(cpu_cost);
+    }
+  }
+
+  // Call between EndFrame() and glfwSwapBuffers(). Blocks until at most
+  // max frames in flight (including this one) are queued on the GPU.
+  void LimitFramesInFlight() {
+    PROFILE_SCOPE_N("FramePacer::LimitFramesInFlight");
+    const time_util::TimePoint start = time_util::now();
+    while (pending_.size() > static_cast<size_t>(max_frames_in_flight_.Get())) {
+      if (!RetireOldestFrame(/*block=*/true)) {
+        break;
+      }
+    }
+    fence_wait_usec_ =
+        static_cast<float>(time_util::elapsed_usec(start).count());
+    PROFILE_VALUE("Frame fence wait (ms)", 1e-3 * fence_wait_usec_);
+  }
+
+  // Number of frames the CPU may queue ahead of the GPU, clamped to
+  // [kMinFramesInFlight, kMaxFramesInFlight].
+  void SetMaxFramesInFlight(const int max_frames_in_flight) {
+    max_frames_in_flight_.Set(max_frames_in_flight);
+    DEBUG("Max frames in flight: {}", max_frames_in_flight_.Get());
+  }
+  [[nodiscard]] int GetMaxFramesInFlight() const {
+    return max_frames_in_flight_.Get();
+  }
+
+  // Call right after glfwSwapBuffers().
+  void MarkPresented() { last_present_ = time_util::now(); }
+
+  // GPU time of a recent frame, measured with timestamp queries. Results
+  // arrive a few frames late, which is fine for predicting the frame cost.
+  void RecordGpuTime(const time_util::DurationUsec gpu_cost) {
+    gpu_cost_.Record(gpu_cost);
+    if (fps_tracker_ != nullptr) {
+      fps_tracker_->RecordGpuTime(gpu_cost);
+    }
+  }
+
+  // Number of frames submitted but not yet finished by the GPU.
+  [[nodiscard]] size_t FramesInFlight() const { return pending_.size(); }
+
+  // Input-to-present latency of the last retired frame in ms.
+  [[nodiscard]] float EstimatedLatencyMs() const {
+    return 1e-3f * latency_usec_;
+  }
+
+  // Deletes all pending fences. Must be called while the GL context is alive.
+  void ReleaseFences() {
+    for (const PendingFrame &frame : pending_) {
+      glDeleteSync(frame.fence);
+    }
+    pending_.clear();
+  }
+
+  void DebugUI() {
+    if (ImGui::CollapsingHeader("Frame Pacing",
+                                ImGuiTreeNodeFlags_DefaultOpen)) {
+      bool low_latency = low_latency_;
+      if (ImGui::Checkbox("Low latency mode", &low_latency)) {
+        ToggleLowLatencyMode(low_latency);
+      }
+      ImGui::SliderFloat("Margin (ms)", &margin_ms_, 0.f, 5.f, "%.2f");
+      int max_frames_in_flight = max_frames_in_flight_.Get();
+      if (ImGui::SliderInt("Max frames in flight", &max_frames_in_flight,
+                           kMinFramesInFlight, kMaxFramesInFlight)) {
+        SetMaxFramesInFlight(max_frames_in_flight);
+      }
+      ImGui::Text("CPU cost: %.3f ms (max %.3f ms)", 1e-3f * cpu_cost_.Last(),
+                  1e-3f * cpu_cost_.Max());
+      ImGui::Text("GPU cost: %.3f ms (max %.3f ms)", 1e-3f * gpu_cost_.Last(),
+                  1e-3f * gpu_cost_.Max());
+      ImGui::Text("Pacing sleep: %.3f ms", 1e-3f * sleep_usec_);
+      ImGui::Text("Frames in flight: %zu", FramesInFlight());
+      ImGui::Text("Frame fence wait: %.3f ms", 1e-3f * fence_wait_usec_);
+      ImGui::Text("Est. input-to-present latency: %.3f ms",
+                  EstimatedLatencyMs());
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(FramePacer);
+
+private:
+  // Last kFrameCostWindow frame costs.
+  struct CostWindow {
+    void Record(const time_util::DurationUsec cost) {
+      usec[count++ % kFrameCostWindow] = static_cast<float>(cost.count());
+    }
+    [[nodiscard]] float Last() const {
+      return count == 0 ? 0.f : usec[(count - 1) % kFrameCostWindow];
+    }
+    [[nodiscard]] float Max() const {
+      return *std::max_element(usec.begin(), usec.end());
+    }
+
+    std::array<float, kFrameCostWindow> usec{};
+    size_t count{0};
+  };
+
+  struct PendingFrame {
+    GLsync fence{nullptr};
+    time_util::TimePoint input_time;
+    time_util::TimePoint submit_time;
+  };
+
+  // Retires frames whose fence has signalled. With `block`, waits for all of
+  // them.
+  void RetireFrames(const bool block) {
+    while (!pending_.empty()) {
+      if (!RetireOldestFrame(block)) {
+        return;
+      }
+    }
+  }
+
+  // Retires the oldest pending frame if its fence has signalled, waiting for
+  // it with `block`. Returns false if the frame is still in flight.
+  bool RetireOldestFrame(const bool block) {
+    const PendingFrame &frame = pending_.front();
+    const GLuint64 timeout_nsec =
+        block ? static_cast<GLuint64>(
+                    time_util::to_nsec(kFrameFenceTimeout).count())
+              : 0;
+    const GLenum status = glClientWaitSync(
+        frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_nsec);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      if (block) {
+        WARNING("Frame fence not signalled after {} us",
+                kFrameFenceTimeout.count());
+      }
+      return false;
+    }
+    if (status != GL_WAIT_FAILED) {
+      // The fence may have signalled a while ago, so its completion time is
+      // modelled instead: frames run on the GPU in submit order, each for the
+      // last measured GPU cost, and finished no later than now.
+      const time_util::TimePoint gpu_start =
+          std::max(frame.submit_time, gpu_done_);
+      gpu_done_ = std::min(
+          gpu_start + time_util::DurationUsec(
+                          static_cast<int64_t>(gpu_cost_.Last())),
+          time_util::now());
+      latency_usec_ = static_cast<float>(
+          time_util::elapsed_usec(frame.input_time, NextVblank(gpu_done_))
+              .count());
+    }
+    glDeleteSync(frame.fence);
+    pending_.pop_front();
+    return true;
+  }
+
+  // First vblank at or after `time`.
+  [[nodiscard]] time_util::TimePoint
+  NextVblank(const time_util::TimePoint time) const {
+    if (!vsync_ || time <= last_present_) {
+      return time;
+    }
+    const auto intervals =
+        (time - last_present_ + refresh_interval_ -
+         time_util::DurationUsec(1)) /
+        refresh_interval_;
+    return last_present_ + intervals * refresh_interval_;
+  }
+
+  [[nodiscard]] time_util::DurationUsec PredictedFrameCost() const {
+    return time_util::DurationUsec(static_cast<int64_t>(
+        cpu_cost_.Max() + gpu_cost_.Max() + 1e3f * margin_ms_));
+  }
+
+  FpsTracker *fps_tracker_;
+
+  bool low_latency_{false};
+  bool vsync_{false};
+  float margin_ms_{kDefaultPacingMarginMs};
+  BoundedType<int> max_frames_in_flight_{
+      kDefaultFramesInFlight, kMinFramesInFlight, kMaxFramesInFlight};
+  time_util::DurationUsec refresh_interval_{};
+
+  std::deque<PendingFrame> pending_;
+  time_util::TimePoint input_time_{time_util::now()};
+  time_util::TimePoint last_present_{time_util::now()};
+  // Modelled completion time of the last retired frame.
+  time_util::TimePoint gpu_done_{time_util::now()};
+
+  CostWindow cpu_cost_;
+  CostWindow gpu_cost_;
+  float sleep_usec_{0.f};
+  float fence_wait_usec_{0.f};
+  float latency_usec_{0.f};
+};
+
+} // namespace gib
@@ -1,10 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cfloat>
+#include <fstream>
+#include <string>
+
+#include <fmt/format.h>
 
 #include "util/macros.h"
 #include "util/report/report.h"
 #include "util/time/downsampler.h"
+#include "util/time/histogram.h"
 #include "util/time/time.h"
 
 #include "engine/core/types.h"
@@ -15,6 +22,13 @@
 static constexpr int kDefaultWidth = 800;
 static constexpr int kDefaultHeight = 600;
 static constexpr size_t kFrameDelta = 120;
+// Refresh rate assumed until the monitor's video mode is known.
+static constexpr float kDefaultRefreshRateHz = 60.f;
+// Percentiles reported for frame, CPU and GPU times.
+static constexpr std::array<float, 4> kFrameTimePercentiles = {50.f, 90.f,
+                                                               99.f, 99.9f};
+// Number of bins of the frame-time distribution plot.
+static constexpr int kFrameTimePlotBins = 32;
 
 namespace gib {
 
@@ -31,14 +45,34 @@ struct FrameTick {
   const time_util::DurationUsec delta_time;
 };
 
-// Track FPS over the last kFrameDelta frames.
+// Frame, CPU and GPU time histograms over the same period. CPU time runs from
+// input sampling to the last draw call, GPU time is the frame's GPU work as
+// measured by timestamp queries.
+struct FrameTimeStats {
+  time_util::DurationHistogram frame;
+  time_util::DurationHistogram cpu;
+  time_util::DurationHistogram gpu;
+
+  void Reset() {
+    frame.Reset();
+    cpu.Reset();
+    gpu.Reset();
+  }
+};
+
+// Track FPS over the last kFrameDelta frames, and frame-time percentiles over
+// a resettable window and over the whole run.
 class FpsTracker {
 public:
   explicit FpsTracker(const float report_dt) {
     downsampler_.SetDt(report_dt);
     fps_stat_.frame_deltas.fill(0.f);
   }
-  ~FpsTracker() = default;
+  ~FpsTracker() {
+    if (!json_export_path_.empty()) {
+      ExportJson(json_export_path_);
+    }
+  }
 
   // Average FPS over the sliding window.
   [[nodiscard]] float GetAvgFps() const {
@@ -52,8 +86,10 @@ public:
 
   // Call once per rendered frame.
   void Tick(const FrameTick &frame_tick) {
-    const auto delta_time = time_util::to_seconds<time_util::DurationUsec>(
-        time_util::elapsed_usec(last_time_, frame_tick.current_time));
+    const auto elapsed =
+        time_util::elapsed_usec(last_time_, frame_tick.current_time);
+    const auto delta_time =
+        time_util::to_seconds<time_util::DurationUsec>(elapsed);
     last_time_ = frame_tick.current_time;
 
     const size_t offset = fps_stat_.frame_count % kFrameDelta;
@@ -65,6 +101,64 @@ public:
       DEBUG("Avg FPS: {}", GetAvgFps());
     }
     fps_stat_.frame_deltas[offset] = delta_time;
+
+    // The first frame has no previous frame to measure against.
+    if (fps_stat_.frame_count > 1) {
+      window_stats_.frame.Record(elapsed);
+      total_stats_.frame.Record(elapsed);
+    }
+    if (window_dt_.count() > 0 &&
+        frame_tick.current_time - window_start_ >= window_dt_) {
+      ResetWindow(frame_tick.current_time);
+    }
+  }
+
+  // CPU and GPU cost of a frame, e.g. from FramePacer. GPU results arrive a
+  // few frames late.
+  void RecordCpuTime(const time_util::DurationUsec cpu_time) {
+    window_stats_.cpu.Record(cpu_time);
+    total_stats_.cpu.Record(cpu_time);
+  }
+  void RecordGpuTime(const time_util::DurationUsec gpu_time) {
+    window_stats_.gpu.Record(gpu_time);
+    total_stats_.gpu.Record(gpu_time);
+  }
+
+  // Starts a new percentile window. The whole-run stats are kept.
+  void ResetWindow(const time_util::TimePoint now = time_util::now()) {
+    window_stats_.Reset();
+    window_start_ = now;
+  }
+
+  // Resets the percentile window every `window_s` seconds, 0 to only reset
+  // on ResetWindow().
+  void SetWindowDuration(const float window_s) {
+    window_dt_ = time_util::seconds_to_usec(window_s);
+  }
+
+  [[nodiscard]] const FrameTimeStats &GetWindowStats() const {
+    return window_stats_;
+  }
+  [[nodiscard]] const FrameTimeStats &GetTotalStats() const {
+    return total_stats_;
+  }
+
+  // Writes the whole-run and current window percentiles to `path` when the
+  // tracker is destroyed, i.e. at exit.
+  void SetJsonExportPath(const std::string &path) { json_export_path_ = path; }
+
+  // Writes the whole-run and current window percentiles (in ms) as JSON.
+  bool ExportJson(const std::string &path) const {
+    std::ofstream file(path);
+    if (!file) {
+      WARNING("Failed to open {} for frame time export", path);
+      return false;
+    }
+    file << "{\n  \"total\": " << StatsToJson(total_stats_, "  ")
+         << ",\n  \"window\": " << StatsToJson(window_stats_, "  ")
+         << "\n}\n";
+    INFO("Exported frame time stats to {}", path);
+    return true;
   }
 
   void DebugUI() {
@@ -80,12 +174,102 @@ public:
 
       ImGui::SameLine();
       ImGui::Text("Frame dt: %.3f ms", 1e3f * frame_dt_s);
+
+      // Last kFrameDelta frame times, oldest first.
+      std::array<float, kFrameDelta> frame_ms{};
+      for (size_t i = 0; i < kFrameDelta; ++i) {
+        frame_ms[i] =
+            1e3f * stat.frame_deltas[(stat.frame_count + i) % kFrameDelta];
+      }
+      ImGui::PlotLines("Frame time (ms)", frame_ms.data(),
+                       static_cast<int>(frame_ms.size()), 0, nullptr, 0.f,
+                       FLT_MAX, ImVec2(0.f, 60.f));
+
+      // Distribution of the current window, up to its max.
+      const time_util::DurationHistogram &frame = window_stats_.frame;
+      const auto bin_usec = std::max<int64_t>(
+          1, frame.Max().count() / kFrameTimePlotBins + 1);
+      std::array<float, kFrameTimePlotBins> bins{};
+      for (int i = 0; i < kFrameTimePlotBins; ++i) {
+        bins[i] = static_cast<float>(frame.CountBetween(
+            time_util::DurationUsec(i * bin_usec),
+            time_util::DurationUsec((i + 1) * bin_usec)));
+      }
+      const std::string overlay = fmt::format(
+          "0 - {:.1f} ms", ToMs(time_util::DurationUsec(
+                               bin_usec * kFrameTimePlotBins)));
+      ImGui::PlotHistogram("Distribution", bins.data(), kFrameTimePlotBins, 0,
+                           overlay.c_str(), 0.f, FLT_MAX, ImVec2(0.f, 60.f));
+
+      PercentileTable(window_stats_);
+      ImGui::Text("Window: %llu frames",
+                  static_cast<unsigned long long>(frame.Count()));
+      ImGui::SameLine();
+      if (ImGui::Button("Reset window")) {
+        ResetWindow();
+      }
     }
   }
 
   DISALLOW_COPY_AND_ASSIGN(FpsTracker);
 
 private:
+  static std::string StatsToJson(const FrameTimeStats &stats,
+                                 const std::string &indent) {
+    std::string json = "{";
+    const char *separator = "";
+    const std::pair<const char *, const time_util::DurationHistogram *>
+        histograms[] = {
+            {"frame", &stats.frame}, {"cpu", &stats.cpu}, {"gpu", &stats.gpu}};
+    for (const auto &[name, histogram] : histograms) {
+      json += fmt::format("{}\n{}  \"{}\": {{\"count\": {}", separator,
+                          indent, name, histogram->Count());
+      separator = ",";
+      for (const float percentile : kFrameTimePercentiles) {
+        json += fmt::format(", \"p{}_ms\": {:.3f}", percentile,
+                            ToMs(histogram->Percentile(percentile)));
+      }
+      json += fmt::format(", \"max_ms\": {:.3f}}}", ToMs(histogram->Max()));
+    }
+    return json + "\n" + indent + "}";
+  }
+
+  static float ToMs(const time_util::DurationUsec duration) {
+    return 1e-3f * static_cast<float>(duration.count());
+  }
+
+  static void PercentileTable(const FrameTimeStats &stats) {
+    static constexpr int kColumns = 2 + kFrameTimePercentiles.size();
+    if (!ImGui::BeginTable("frame_time_percentiles", kColumns,
+                           ImGuiTableFlags_Borders |
+                               ImGuiTableFlags_SizingFixedFit)) {
+      return;
+    }
+    ImGui::TableSetupColumn("ms");
+    for (const float percentile : kFrameTimePercentiles) {
+      ImGui::TableSetupColumn(fmt::format("p{}", percentile).c_str());
+    }
+    ImGui::TableSetupColumn("max");
+    ImGui::TableHeadersRow();
+
+    const std::pair<const char *, const time_util::DurationHistogram *>
+        rows[] = {{"Frame", &stats.frame},
+                  {"CPU", &stats.cpu},
+                  {"GPU", &stats.gpu}};
+    for (const auto &[name, histogram] : rows) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(name);
+      for (const float percentile : kFrameTimePercentiles) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", ToMs(histogram->Percentile(percentile)));
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", ToMs(histogram->Max()));
+    }
+    ImGui::EndTable();
+  }
+
   time_util::DownSampler downsampler_;
   time_util::TimePoint last_time_{time_util::now()};
 
@@ -97,6 +281,12 @@ private:
   };
 
   FpsStat fps_stat_;
+
+  FrameTimeStats window_stats_;
+  FrameTimeStats total_stats_;
+  time_util::TimePoint window_start_{time_util::now()};
+  time_util::DurationUsec window_dt_{0};
+  std::string json_export_path_;
 };
 
 } // namespace gib
\ No newline at end of file
@@ -0,0 +1,511 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+
+#include "third_party/glad/glad.h"
+#include "third_party/imgui/imgui.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+
+namespace gib {
+
+// Texture units whose bindings are cached. Units above this are always
+// forwarded to GL.
+static constexpr GLuint kMaxCachedTextureUnits = 32;
+
+// Cache of the GL state of the current context. Calls that would not change
+// the bound program, VAO, buffers, textures, samplers, fixed-function state or
+// viewport are skipped, since driver call overhead dominates the CPU cost of
+// busy scenes.
+//
+// The cache only stays correct if all state changes go through it. Code that
+// changes state behind its back (e.g. third party renderers that do not
+// restore state) must call Invalidate() afterwards. Objects must be deleted
+// through the Delete*() functions so stale names are dropped.
+//
+// There is one GLCore per GL context, owned by the window. Engine objects
+// reach it through GLCore::Current(). Must only be used from the thread owning
+// the context.
+class GLCore {
+public:
+  GLCore() {
+    ASSERT(current_ == nullptr, "Only one GLCore may exist at a time");
+    current_ = this;
+  }
+  ~GLCore() { current_ = nullptr; }
+
+  // GLCore of the current context.
+  static GLCore &Current() {
+    ASSERT(current_ != nullptr, "No GLCore, create a window first");
+    return *current_;
+  }
+
+  // Forgets all cached state, the next call of each kind is issued.
+  void Invalidate() {
+    program_.Reset();
+    vertex_array_.Reset();
+    for (CachedBinding &binding : buffers_) {
+      binding.buffer.Reset();
+    }
+    indexed_buffers_.clear();
+    active_texture_unit_.Reset();
+    for (auto &unit : textures_) {
+      for (Cached<GLuint> &texture : unit) {
+        texture.Reset();
+      }
+    }
+    for (Cached<GLuint> &sampler : samplers_) {
+      sampler.Reset();
+    }
+    for (CachedCapability &capability : capabilities_) {
+      capability.enabled.Reset();
+    }
+    blend_func_.Reset();
+    blend_equation_.Reset();
+    depth_func_.Reset();
+    depth_mask_.Reset();
+    stencil_func_.Reset();
+    stencil_op_.Reset();
+    stencil_mask_.Reset();
+    cull_face_.Reset();
+    polygon_mode_.Reset();
+    viewport_.Reset();
+  }
+
+  void UseProgram(const GLuint program) {
+    if (Skip(program_, program)) {
+      return;
+    }
+    glUseProgram(program);
+  }
+
+  void BindVertexArray(const GLuint vertex_array) {
+    if (Skip(vertex_array_, vertex_array)) {
+      return;
+    }
+    glBindVertexArray(vertex_array);
+    // The element buffer binding is part of the VAO.
+    if (CachedBinding *binding = FindBuffer(GL_ELEMENT_ARRAY_BUFFER)) {
+      binding->buffer.Reset();
+    }
+  }
+
+  void BindBuffer(const GLenum target, const GLuint buffer) {
+    CachedBinding *binding = FindBuffer(target);
+    if (binding != nullptr && Skip(binding->buffer, buffer)) {
+      return;
+    }
+    if (binding == nullptr) {
+      ++frame_stats_.issued;
+    }
+    glBindBuffer(target, buffer);
+  }
+
+  // Also binds `buffer` to the generic `target` binding, like GL does.
+  void BindBufferBase(const GLenum target, const GLuint index,
+                      const GLuint buffer) {
+    if (SkipIndexed(target, index, {buffer, 0, 0})) {
+      return;
+    }
+    glBindBufferBase(target, index, buffer);
+  }
+
+  // Binds `size` bytes of `buffer` from `offset`. Also binds `buffer` to the
+  // generic `target` binding, like GL does.
+  void BindBufferRange(const GLenum target, const GLuint index,
+                       const GLuint buffer, const GLintptr offset,
+                       const GLsizeiptr size) {
+    if (SkipIndexed(target, index, {buffer, offset, size})) {
+      return;
+    }
+    glBindBufferRange(target, index, buffer, offset, size);
+  }
+
+  // `unit` is the unit index, not GL_TEXTURE0 + unit.
+  void ActiveTexture(const GLuint unit) {
+    if (Skip(active_texture_unit_, unit)) {
+      return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+
+  // Binds `texture` to `target` of the active texture unit.
+  void BindTexture(const GLenum target, const GLuint texture) {
+    const int target_index = TextureTargetIndex(target);
+    if (!active_texture_unit_.valid ||
+        active_texture_unit_.value >= kMaxCachedTextureUnits ||
+        target_index < 0) {
+      ++frame_stats_.issued;
+      glBindTexture(target, texture);
+      return;
+    }
+    if (Skip(textures_[active_texture_unit_.value][target_index], texture)) {
+      return;
+    }
+    glBindTexture(target, texture);
+  }
+
+  void BindTextureToUnit(const GLuint unit, const GLenum target,
+                         const GLuint texture) {
+    ActiveTexture(unit);
+    BindTexture(target, texture);
+  }
+
+  void BindSampler(const GLuint unit, const GLuint sampler) {
+    if (unit < kMaxCachedTextureUnits && Skip(samplers_[unit], sampler)) {
+      return;
+    }
+    if (unit >= kMaxCachedTextureUnits) {
+      ++frame_stats_.issued;
+    }
+    glBindSampler(unit, sampler);
+  }
+
+  // glEnable/glDisable.
+  void SetCapability(const GLenum capability, const bool enable) {
+    CachedCapability *cached = FindCapability(capability);
+    if (cached != nullptr && Skip(cached->enabled, enable)) {
+      return;
+    }
+    if (cached == nullptr) {
+      ++frame_stats_.issued;
+    }
+    if (enable) {
+      glEnable(capability);
+    } else {
+      glDisable(capability);
+    }
+  }
+
+  void BlendFunc(const GLenum src, const GLenum dst) {
+    if (Skip(blend_func_, {src, dst, 0})) {
+      return;
+    }
+    glBlendFunc(src, dst);
+  }
+
+  void BlendEquation(const GLenum mode) {
+    if (Skip(blend_equation_, mode)) {
+      return;
+    }
+    glBlendEquation(mode);
+  }
+
+  void DepthFunc(const GLenum func) {
+    if (Skip(depth_func_, func)) {
+      return;
+    }
+    glDepthFunc(func);
+  }
+
+  void DepthMask(const bool write) {
+    if (Skip(depth_mask_, write)) {
+      return;
+    }
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+  }
+
+  void StencilFunc(const GLenum func, const GLint ref, const GLuint mask) {
+    if (Skip(stencil_func_, {func, static_cast<GLenum>(ref), mask})) {
+      return;
+    }
+    glStencilFunc(func, ref, mask);
+  }
+
+  void StencilOp(const GLenum sfail, const GLenum dpfail,
+                 const GLenum dppass) {
+    if (Skip(stencil_op_, {sfail, dpfail, dppass})) {
+      return;
+    }
+    glStencilOp(sfail, dpfail, dppass);
+  }
+
+  void StencilMask(const GLuint mask) {
+    if (Skip(stencil_mask_, mask)) {
+      return;
+    }
+    glStencilMask(mask);
+  }
+
+  void CullFace(const GLenum mode) {
+    if (Skip(cull_face_, mode)) {
+      return;
+    }
+    glCullFace(mode);
+  }
+
+  // Applies to GL_FRONT_AND_BACK, the only face core profiles allow.
+  void PolygonMode(const GLenum mode) {
+    if (Skip(polygon_mode_, mode)) {
+      return;
+    }
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+  }
+
+  void Viewport(const GLint x, const GLint y, const GLsizei width,
+                const GLsizei height) {
+    if (Skip(viewport_, {x, y, width, height})) {
+      return;
+    }
+    glViewport(x, y, width, height);
+  }
+
+  // Deletes GL objects and drops them from the cache. GL unbinds deleted
+  // objects from the current context, so must the cache.
+  void DeleteProgram(const GLuint program) {
+    // Unlike other objects, a program in use stays current after deletion.
+    if (program_.valid && program_.value == program) {
+      program_.Reset();
+    }
+    glDeleteProgram(program);
+  }
+  void DeleteVertexArray(const GLuint vertex_array) {
+    if (vertex_array_.valid && vertex_array_.value == vertex_array) {
+      vertex_array_.Set(0);
+      FindBuffer(GL_ELEMENT_ARRAY_BUFFER)->buffer.Reset();
+    }
+    glDeleteVertexArrays(1, &vertex_array);
+  }
+  void DeleteBuffer(const GLuint buffer) {
+    for (CachedBinding &binding : buffers_) {
+      Forget(binding.buffer, buffer);
+    }
+    for (auto it = indexed_buffers_.begin(); it != indexed_buffers_.end();) {
+      it = it->second.buffer == buffer ? indexed_buffers_.erase(it)
+                                       : std::next(it);
+    }
+    glDeleteBuffers(1, &buffer);
+  }
+  void DeleteTexture(const GLuint texture) {
+    for (auto &unit : textures_) {
+      for (Cached<GLuint> &bound : unit) {
+        Forget(bound, texture);
+      }
+    }
+    glDeleteTextures(1, &texture);
+  }
+  void DeleteSampler(const GLuint sampler) {
+    for (Cached<GLuint> &bound : samplers_) {
+      Forget(bound, sampler);
+    }
+    glDeleteSamplers(1, &sampler);
+  }
+
+  // Call once per frame, publishes the per-frame call counts.
+  void EndFrame() {
+    last_frame_stats_ = frame_stats_;
+    frame_stats_ = {};
+    PROFILE_VALUE("GL state calls skipped",
+                  static_cast<int64_t>(last_frame_stats_.skipped));
+  }
+
+  // State changes issued and skipped during the last frame.
+  [[nodiscard]] size_t LastFrameIssuedCalls() const {
+    return last_frame_stats_.issued;
+  }
+  [[nodiscard]] size_t LastFrameSkippedCalls() const {
+    return last_frame_stats_.skipped;
+  }
+
+  void DebugUI() {
+    if (ImGui::CollapsingHeader("GL State Cache")) {
+      const size_t total =
+          last_frame_stats_.issued + last_frame_stats_.skipped;
+      ImGui::Text("State calls issued: %zu", last_frame_stats_.issued);
+      ImGui::Text("State calls skipped: %zu (%.1f%%)",
+                  last_frame_stats_.skipped,
+                  total == 0 ? 0.f
+                             : 100.f *
+                                   static_cast<float>(
+                                       last_frame_stats_.skipped) /
+                                   static_cast<float>(total));
+      if (ImGui::Button("Invalidate")) {
+        Invalidate();
+      }
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(GLCore);
+
+private:
+  // A cached value, invalid until first set.
+  template <typename T> struct Cached {
+    T value{};
+    bool valid{false};
+
+    void Set(const T &new_value) {
+      value = new_value;
+      valid = true;
+    }
+    void Reset() { valid = false; }
+  };
+
+  struct CachedBinding {
+    GLenum target;
+    Cached<GLuint> buffer;
+  };
+
+  // Buffer range bound to an indexed target. Size 0 is the whole buffer.
+  struct IndexedBinding {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+
+    bool operator==(const IndexedBinding &other) const {
+      return buffer == other.buffer && offset == other.offset &&
+             size == other.size;
+    }
+  };
+
+  struct CachedCapability {
+    GLenum capability;
+    Cached<bool> enabled;
+  };
+
+  // Up to three parameters of one state call.
+  struct Params {
+    GLenum a;
+    GLenum b;
+    GLenum c;
+    bool operator==(const Params &other) const {
+      return a == other.a && b == other.b && c == other.c;
+    }
+  };
+
+  struct Rect {
+    GLint x;
+    GLint y;
+    GLsizei width;
+    GLsizei height;
+    bool operator==(const Rect &other) const {
+      return x == other.x && y == other.y && width == other.width &&
+             height == other.height;
+    }
+  };
+
+  struct CallStats {
+    size_t issued{0};
+    size_t skipped{0};
+  };
+
+  // Returns true and counts a skipped call if `cached` already holds `value`,
+  // else stores `value` and counts an issued call.
+  template <typename T> bool Skip(Cached<T> &cached, const T &value) {
+    if (cached.valid && cached.value == value) {
+      ++frame_stats_.skipped;
+      return true;
+    }
+    cached.Set(value);
+    ++frame_stats_.issued;
+    return false;
+  }
+
+  // Skip() for indexed buffer bindings, also updates the generic binding.
+  bool SkipIndexed(const GLenum target, const GLuint index,
+                   const IndexedBinding &binding) {
+    const uint64_t key = (static_cast<uint64_t>(target) << 32) | index;
+    auto it = indexed_buffers_.find(key);
+    if (it != indexed_buffers_.end() && it->second == binding) {
+      ++frame_stats_.skipped;
+      return true;
+    }
+    ++frame_stats_.issued;
+    indexed_buffers_[key] = binding;
+    if (CachedBinding *generic = FindBuffer(target)) {
+      generic->buffer.Set(binding.buffer);
+    }
+    return false;
+  }
+
+  // Deleted objects revert their bindings to 0.
+  template <typename T> static void Forget(Cached<T> &cached, const T &name) {
+    if (cached.valid && cached.value == name) {
+      cached.Set(0);
+    }
+  }
+
+  CachedBinding *FindBuffer(const GLenum target) {
+    for (CachedBinding &binding : buffers_) {
+      if (binding.target == target) {
+        return &binding;
+      }
+    }
+    return nullptr;
+  }
+
+  CachedCapability *FindCapability(const GLenum capability) {
+    for (CachedCapability &cached : capabilities_) {
+      if (cached.capability == capability) {
+        return &cached;
+      }
+    }
+    return nullptr;
+  }
+
+  static int TextureTargetIndex(const GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D:
+      return 0;
+    case GL_TEXTURE_CUBE_MAP:
+      return 1;
+    case GL_TEXTURE_2D_ARRAY:
+      return 2;
+    case GL_TEXTURE_3D:
+      return 3;
+    default:
+      return -1;
+    }
+  }
+
+  static inline GLCore *current_ = nullptr;
+
+  Cached<GLuint> program_;
+  Cached<GLuint> vertex_array_;
+  std::array<CachedBinding, 8> buffers_{{
+      {GL_ARRAY_BUFFER, {}},
+      {GL_ELEMENT_ARRAY_BUFFER, {}},
+      {GL_UNIFORM_BUFFER, {}},
+      {GL_PIXEL_PACK_BUFFER, {}},
+      {GL_PIXEL_UNPACK_BUFFER, {}},
+      {GL_COPY_READ_BUFFER, {}},
+      {GL_COPY_WRITE_BUFFER, {}},
+      {GL_DRAW_INDIRECT_BUFFER, {}},
+  }};
+  // Keyed by target << 32 | index.
+  std::unordered_map<uint64_t, IndexedBinding> indexed_buffers_;
+
+  Cached<GLuint> active_texture_unit_;
+  // Per unit: 2D, cube map, 2D array, 3D.
+  std::array<std::array<Cached<GLuint>, 4>, kMaxCachedTextureUnits> textures_;
+  std::array<Cached<GLuint>, kMaxCachedTextureUnits> samplers_;
+
+  std::array<CachedCapability, 8> capabilities_{{
+      {GL_BLEND, {}},
+      {GL_DEPTH_TEST, {}},
+      {GL_STENCIL_TEST, {}},
+      {GL_CULL_FACE, {}},
+      {GL_SCISSOR_TEST, {}},
+      {GL_MULTISAMPLE, {}},
+      {GL_TEXTURE_CUBE_MAP_SEAMLESS, {}},
+      {GL_FRAMEBUFFER_SRGB, {}},
+  }};
+  Cached<Params> blend_func_;
+  Cached<GLenum> blend_equation_;
+  Cached<GLenum> depth_func_;
+  Cached<bool> depth_mask_;
+  Cached<Params> stencil_func_;
+  Cached<Params> stencil_op_;
+  Cached<GLuint> stencil_mask_;
+  Cached<GLenum> cull_face_;
+  Cached<GLenum> polygon_mode_;
+  Cached<Rect> viewport_;
+
+  CallStats frame_stats_;
+  CallStats last_frame_stats_;
+};
+
+} // namespace gib
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstring>
+
+#include "third_party/glad/glad.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+
+// Tokens newer than the GL 4.1 glad headers.
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace gib {
+
+// Layout of one glMultiDrawElementsIndirect command.
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// Context version and entry points beyond GL 4.1, which glad does not load.
+// Loaded once the context is current, through the same loader as glad. Check
+// the capability flags before calling any of the function pointers, they are
+// null when unsupported.
+class GLExtensions {
+public:
+  using MultiDrawElementsIndirectProc = void(APIENTRYP)(GLenum mode,
+                                                        GLenum type,
+                                                        const void *indirect,
+                                                        GLsizei draw_count,
+                                                        GLsizei stride);
+  using BufferStorageProc = void(APIENTRYP)(GLenum target, GLsizeiptr size,
+                                            const void *data,
+                                            GLbitfield flags);
+  using MaxShaderCompilerThreadsProc = void(APIENTRYP)(GLuint count);
+
+  // Extensions of the current context.
+  static GLExtensions &Get() {
+    static GLExtensions extensions;
+    return extensions;
+  }
+
+  // Reads the context version and loads the entry points through `loader`.
+  void Load(const GLADloadproc loader) {
+    glGetIntegerv(GL_MAJOR_VERSION, &major_version_);
+    glGetIntegerv(GL_MINOR_VERSION, &minor_version_);
+
+    const bool has_mdi =
+        AtLeast(4, 3) || HasExtension("GL_ARB_multi_draw_indirect");
+    const bool has_ssbo =
+        AtLeast(4, 3) || HasExtension("GL_ARB_shader_storage_buffer_object");
+    const bool has_draw_parameters =
+        AtLeast(4, 6) || HasExtension("GL_ARB_shader_draw_parameters");
+
+    multi_draw_elements_indirect_ = nullptr;
+    if (has_mdi) {
+      multi_draw_elements_indirect_ =
+          reinterpret_cast<MultiDrawElementsIndirectProc>(
+              loader("glMultiDrawElementsIndirect"));
+    }
+    // The MDI path indexes per-draw SSBO data with gl_BaseInstance.
+    supports_multi_draw_indirect_ = multi_draw_elements_indirect_ != nullptr &&
+                                    has_ssbo && has_draw_parameters;
+
+    buffer_storage_ = nullptr;
+    if (AtLeast(4, 4) || HasExtension("GL_ARB_buffer_storage")) {
+      buffer_storage_ =
+          reinterpret_cast<BufferStorageProc>(loader("glBufferStorage"));
+    }
+    // The ARB version shares the tokens and semantics of the KHR one.
+    max_shader_compiler_threads_ = nullptr;
+    if (HasExtension("GL_KHR_parallel_shader_compile")) {
+      max_shader_compiler_threads_ =
+          reinterpret_cast<MaxShaderCompilerThreadsProc>(
+              loader("glMaxShaderCompilerThreadsKHR"));
+    } else if (HasExtension("GL_ARB_parallel_shader_compile")) {
+      max_shader_compiler_threads_ =
+          reinterpret_cast<MaxShaderCompilerThreadsProc>(
+              loader("glMaxShaderCompilerThreadsARB"));
+    }
+    if (max_shader_compiler_threads_ != nullptr) {
+      // As many threads as the implementation wants.
+      max_shader_compiler_threads_(0xFFFFFFFF);
+    }
+    INFO("OpenGL {}.{}, multi-draw-indirect: {}, buffer storage: {}, "
+         "parallel shader compile: {}",
+         major_version_, minor_version_, supports_multi_draw_indirect_,
+         SupportsBufferStorage(), SupportsParallelShaderCompile());
+  }
+
+  [[nodiscard]] int MajorVersion() const { return major_version_; }
+  [[nodiscard]] int MinorVersion() const { return minor_version_; }
+
+  // True if the context is at least GL `major`.`minor`.
+  [[nodiscard]] bool AtLeast(const int major, const int minor) const {
+    return major_version_ > major ||
+           (major_version_ == major && minor_version_ >= minor);
+  }
+
+  // True if glMultiDrawElementsIndirect, SSBOs and gl_BaseInstance are
+  // available.
+  [[nodiscard]] bool SupportsMultiDrawIndirect() const {
+    return supports_multi_draw_indirect_;
+  }
+
+  // True if glBufferStorage, and with it persistent mapping, is available.
+  [[nodiscard]] bool SupportsBufferStorage() const {
+    return buffer_storage_ != nullptr;
+  }
+
+  // True if GL_COMPLETION_STATUS_KHR can be queried to poll shader compiles
+  // and program links without blocking.
+  [[nodiscard]] bool SupportsParallelShaderCompile() const {
+    return max_shader_compiler_threads_ != nullptr;
+  }
+
+  // Allocates immutable storage for the buffer bound to `target`.
+  void BufferStorage(const GLenum target, const GLsizeiptr size,
+                     const void *data, const GLbitfield flags) const {
+    ASSERT(buffer_storage_ != nullptr, "glBufferStorage is not supported");
+    buffer_storage_(target, size, data, flags);
+  }
+
+  // Draws `draw_count` commands read from the bound GL_DRAW_INDIRECT_BUFFER
+  // at byte offset `indirect`.
+  void MultiDrawElementsIndirect(const GLenum mode, const GLenum type,
+                                 const void *indirect,
+                                 const GLsizei draw_count,
+                                 const GLsizei stride) const {
+    ASSERT(multi_draw_elements_indirect_ != nullptr,
+           "glMultiDrawElementsIndirect is not supported");
+    multi_draw_elements_indirect_(mode, type, indirect, draw_count, stride);
+  }
+
+  // True if the current context advertises `name`.
+  [[nodiscard]] static bool HasExtension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+      const auto *extension = reinterpret_cast<const char *>(
+          glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+      if (extension != nullptr && std::strcmp(extension, name) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(GLExtensions);
+
+private:
+  GLExtensions() = default;
+
+  GLint major_version_{0};
+  GLint minor_version_{0};
+  bool supports_multi_draw_indirect_{false};
+
+  MultiDrawElementsIndirectProc multi_draw_elements_indirect_{nullptr};
+  BufferStorageProc buffer_storage_{nullptr};
+  MaxShaderCompilerThreadsProc max_shader_compiler_threads_{nullptr};
+};
+
+} // namespace gib
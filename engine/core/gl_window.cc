@@ -1,7 +1,19 @@
 #include "engine/core/gl_window.h"
 #include "engine/core/frame_util.h"
 
+#include <unordered_map>
+
 namespace gib {
+namespace {
+
+// GLFW windows to the GlfwWindow owning them. The GLFW user pointer belongs
+// to WindowBase, so callbacks set by GlfwWindow look their window up here.
+std::unordered_map<GLFWwindow *, GlfwWindow *> &GlfwWindows() {
+  static std::unordered_map<GLFWwindow *, GlfwWindow *> windows;
+  return windows;
+}
+
+} // namespace
 
 // Callback that prints warning for GLFW errors.
 inline void GlfwErrorPrintCallback(int error, const char *description) {
@@ -20,9 +32,17 @@ inline void GLAPIENTRY GlDebugPrintCallback(GLenum /*source*/, GLenum type,
   }
 }
 
-GlfwWindow::GlfwWindow(const std::string title, const Size2D size,
+GlfwWindow::GlfwWindow(std::shared_ptr<GLCore> gl_core, const std::string title,
+                       const GlfwWindowBackend backend,
+                       const GlContextVersion gl_version, const Size2D size,
                        const int samples, const float fps_report_dt)
-    : title_{title}, fps_tracker_(fps_report_dt) {
+    : gl_core_(std::move(gl_core)), title_{title}, backend_(backend),
+      fps_tracker_(fps_report_dt),
+      frame_pacer_(kDefaultRefreshRateHz, &fps_tracker_) {
+  if (IsHeadless()) {
+    // The null platform needs no display server.
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
   glfw_init_success_ = glfwInit();
   ASSERT(glfw_init_success_ == GLFW_TRUE, "Failed to initialize GLFW!");
   DEBUG("Successfully initialized GLFW");
@@ -31,39 +51,69 @@ GlfwWindow::GlfwWindow(const std::string title, const Size2D size,
   ASSERT(size.Width() && size.Height(), "Width & height must be > 0, got {}",
          to_string(size));
 
-  monitor_ = glfwGetPrimaryMonitor();
-  const GLFWvidmode *mode = glfwGetVideoMode(monitor_);
+  if (!IsHeadless()) {
+    monitor_ = glfwGetPrimaryMonitor();
+    const GLFWvidmode *mode = glfwGetVideoMode(monitor_);
 
-  glfwWindowHint(GLFW_RED_BITS, mode->redBits);
-  glfwWindowHint(GLFW_GREEN_BITS, mode->greenBits);
-  glfwWindowHint(GLFW_BLUE_BITS, mode->blueBits);
-  glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
+    glfwWindowHint(GLFW_RED_BITS, mode->redBits);
+    glfwWindowHint(GLFW_GREEN_BITS, mode->greenBits);
+    glfwWindowHint(GLFW_BLUE_BITS, mode->blueBits);
+    glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
+    if (mode->refreshRate > 0) {
+      frame_pacer_.SetRefreshRate(static_cast<float>(mode->refreshRate));
+    }
+  }
 
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
 #ifdef __APPLE__
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // Required on Mac
 #endif
 
-  // Start in windowed mode.
-  glfw_window_ptr_ = glfwCreateWindow(size.Width(), size.Height(),
-                                      title_.c_str(), nullptr, nullptr);
+  if (gl_version == GlContextVersion::GL_4_6) {
+    glfw_window_ptr_ = CreateWindowWithContext(size, 4, 6);
+    if (glfw_window_ptr_ == nullptr) {
+      WARNING("Failed to create an OpenGL 4.6 context, falling back to 4.1");
+    }
+  }
+  if (glfw_window_ptr_ == nullptr) {
+    glfw_window_ptr_ = CreateWindowWithContext(size, 4, 1);
+  }
   ASSERT(glfw_window_ptr_ != nullptr, "GLFW window failed to initialize");
+  GlfwWindows()[glfw_window_ptr_] = this;
 
   glfwMakeContextCurrent(glfw_window_ptr_);
 
-  gladLoadGL();
+  if (IsHeadless()) {
+    // glad's built-in loader only knows GLX/WGL/CGL.
+    gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+  } else {
+    gladLoadGL();
+  }
+  GLExtensions::Get().Load(
+      reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
   ToggleOpenGlErrorLogging(true);
+  GpuProfiler::Get().Init();
+  UniformRing::Get().Init();
 
   // Enable multisampling if needed.
   if (samples > 0) {
-    glEnable(GL_MULTISAMPLE);
+    if (IsHeadless()) {
+      WARNING("Multisampling is not supported headless, ignoring {} samples",
+              samples);
+    } else {
+      gl_core_->SetCapability(GL_MULTISAMPLE, true);
+    }
+  }
+
+  if (IsHeadless()) {
+    CreateOffscreenFramebuffer(size);
+    SetViewportSize(size);
   }
 
   ToggleResizeUpdates(true);
-  ToggleVsync(true);
+  // Surfaceless contexts have nothing to sync to.
+  ToggleVsync(!IsHeadless());
   DEBUG("Window setup complete.");
 }
 
@@ -72,9 +122,123 @@ GlfwWindow::~GlfwWindow() {
     WARNING("GLFW failed to initialize, not calling glfwTerminate()");
     return;
   }
+  if (glfw_window_ptr_ != nullptr) {
+    GlfwWindows().erase(glfw_window_ptr_);
+    frame_pacer_.ReleaseFences();
+    GpuProfiler::Get().Release();
+    UniformRing::Get().Release();
+    DeleteOffscreenFramebuffer();
+  }
   glfwTerminate();
 }
 
+GLFWwindow *GlfwWindow::CreateWindowWithContext(const Size2D &size,
+                                                const int major,
+                                                const int minor) {
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+  if (IsHeadless()) {
+    return CreateHeadlessWindow(size);
+  }
+  // Start in windowed mode.
+  return glfwCreateWindow(size.Width(), size.Height(), title_.c_str(), nullptr,
+                          nullptr);
+}
+
+GLFWwindow *GlfwWindow::CreateHeadlessWindow(const Size2D &size) {
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  static constexpr std::pair<int, const char *> kContextApis[] = {
+      {GLFW_EGL_CONTEXT_API, "EGL surfaceless"},
+      {GLFW_OSMESA_CONTEXT_API, "OSMesa"},
+  };
+  for (const auto &[api, name] : kContextApis) {
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+    GLFWwindow *window = glfwCreateWindow(size.Width(), size.Height(),
+                                          title_.c_str(), nullptr, nullptr);
+    if (window != nullptr) {
+      context_api_name_ = name;
+      INFO("Created headless window with {} context", name);
+      return window;
+    }
+    WARNING("Failed to create headless window with {} context", name);
+  }
+  return nullptr;
+}
+
+void GlfwWindow::CreateOffscreenFramebuffer(const Size2D &size) {
+  DeleteOffscreenFramebuffer();
+
+  glGenRenderbuffers(1, &offscreen_color_);
+  glBindRenderbuffer(GL_RENDERBUFFER, offscreen_color_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.Width(),
+                        size.Height());
+
+  glGenRenderbuffers(1, &offscreen_depth_stencil_);
+  glBindRenderbuffer(GL_RENDERBUFFER, offscreen_depth_stencil_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.Width(),
+                        size.Height());
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &offscreen_fbo_);
+  glBindFramebuffer(GL_FRAMEBUFFER, offscreen_fbo_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, offscreen_color_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, offscreen_depth_stencil_);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    THROW_FATAL("Offscreen framebuffer incomplete, status 0x{:x}", status);
+  }
+  offscreen_size_ = size;
+  DEBUG("Created offscreen framebuffer {}", to_string(size));
+}
+
+void GlfwWindow::DeleteOffscreenFramebuffer() {
+  if (offscreen_fbo_ == 0) {
+    return;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &offscreen_fbo_);
+  glDeleteRenderbuffers(1, &offscreen_color_);
+  glDeleteRenderbuffers(1, &offscreen_depth_stencil_);
+  offscreen_fbo_ = 0;
+  offscreen_color_ = 0;
+  offscreen_depth_stencil_ = 0;
+}
+
+void GlfwWindow::SwapBuffers() {
+  if (IsHeadless()) {
+    glFlush();
+  } else {
+    glfwSwapBuffers(glfw_window_ptr_);
+  }
+  const std::optional<time_util::DurationUsec> gpu_time =
+      GpuProfiler::Get().Collect();
+  if (gpu_time.has_value()) {
+    frame_pacer_.RecordGpuTime(*gpu_time);
+  }
+  UniformRing::Get().EndFrame();
+  gl_core_->EndFrame();
+}
+
+std::vector<unsigned char> GlfwWindow::ReadFramebufferPixels() {
+  int width = 0;
+  int height = 0;
+  if (IsHeadless()) {
+    width = offscreen_size_.Width();
+    height = offscreen_size_.Height();
+  } else {
+    glfwGetFramebufferSize(glfw_window_ptr_, &width, &height);
+  }
+  std::vector<unsigned char> pixels(static_cast<size_t>(width) *
+                                    static_cast<size_t>(height) * 4);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, offscreen_fbo_);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  return pixels;
+}
+
 void GlfwWindow::ToggleGlfwErrorLogging(const bool enable) {
   if (glfw_error_logging_enabled_ == enable) {
     return;
@@ -124,13 +288,17 @@ void GlfwWindow::SetWindowSize(const Size2D &size) {
 }
 
 void GlfwWindow::SetViewportSize(const Size2D &size) {
-  glViewport(0, 0, size.Width(), size.Height());
+  gl_core_->Viewport(0, 0, size.Width(), size.Height());
 }
 
 void GlfwWindow::ToggleFullscreen(const bool &fullscreen) {
   if (fullscreen == ctx_.fullscreen) {
     return;
   }
+  if (IsHeadless()) {
+    WARNING("Fullscreen is not supported by headless windows");
+    return;
+  }
 
   if (fullscreen) {
     GLFWmonitor *monitor = glfwGetPrimaryMonitor();
@@ -155,8 +323,10 @@ void GlfwWindow::ToggleResizeUpdates(const bool &enable_resize_updates) {
   }
   if (enable_resize_updates) {
     auto callback = [](GLFWwindow *window, int width, int height) {
-      auto *self = static_cast<GlfwWindow *>(glfwGetWindowUserPointer(window));
-      self->FramebufferSizeCallback(window, width, height);
+      const auto it = GlfwWindows().find(window);
+      if (it != GlfwWindows().end()) {
+        it->second->FramebufferSizeCallback(window, width, height);
+      }
     };
     glfwSetFramebufferSizeCallback(glfw_window_ptr_, callback);
   } else {
@@ -170,11 +340,16 @@ void GlfwWindow::ToggleVsync(const bool &enable_vsync) {
   if (enable_vsync == ctx_.enable_vsync) {
     return;
   }
+  if (IsHeadless() && enable_vsync) {
+    WARNING("Vsync is not supported by headless windows");
+    return;
+  }
   if (enable_vsync) {
     glfwSwapInterval(1);
   } else {
     glfwSwapInterval(0);
   }
+  frame_pacer_.ToggleVsync(enable_vsync);
   ctx_.enable_vsync = enable_vsync;
   DEBUG("Vsync enabled: {}", enable_vsync);
 }
@@ -183,12 +358,7 @@ void GlfwWindow::ToggleWireframe(const bool &enable_wireframe) {
   if (enable_wireframe == ctx_.enable_wireframe) {
     return;
   }
-  if (enable_wireframe) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-  } else {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  }
+  gl_core_->PolygonMode(enable_wireframe ? GL_LINE : GL_FILL);
   ctx_.enable_wireframe = enable_wireframe;
   DEBUG("Wireframe enabled: {}", enable_wireframe);
 }
@@ -197,12 +367,7 @@ void GlfwWindow::ToggleDepthTest(const bool &enable_depth_test) {
   if (enable_depth_test == ctx_.enable_depth_test) {
     return;
   }
-  if (enable_depth_test) {
-    glEnable(GL_DEPTH_TEST);
-
-  } else {
-    glDisable(GL_DEPTH_TEST);
-  }
+  gl_core_->SetCapability(GL_DEPTH_TEST, enable_depth_test);
   ctx_.enable_depth_test = enable_depth_test;
   DEBUG("Depth test enabled: {}", enable_depth_test);
 }
@@ -212,17 +377,15 @@ void GlfwWindow::ToggleStencilTest(const bool &enable_stencil_test,
   if (enable_stencil_test == ctx_.enable_stencil_test) {
     return;
   }
+  gl_core_->SetCapability(GL_STENCIL_TEST, enable_stencil_test);
   if (enable_stencil_test) {
-    glEnable(GL_STENCIL_TEST);
     // Only replace the value in the stencil buffer if both the stencil and
     // depth test pass.
-    glStencilOp(/*sfail=*/GL_KEEP, /*dpfail=*/GL_KEEP, /*dppass=*/GL_REPLACE);
+    gl_core_->StencilOp(/*sfail=*/GL_KEEP, /*dpfail=*/GL_KEEP,
+                        /*dppass=*/GL_REPLACE);
     // Set the stencil test to use the given `func` when comparing for
     // fragment liveness.
-    glStencilFunc(func, /*ref=*/1, /*mask=*/0xFF);
-
-  } else {
-    glDisable(GL_STENCIL_TEST);
+    gl_core_->StencilFunc(func, /*ref=*/1, /*mask=*/0xFF);
   }
   ctx_.enable_stencil_test = enable_stencil_test;
   DEBUG("Stencil test enabled: {}", enable_stencil_test);
@@ -232,11 +395,7 @@ void GlfwWindow::ToggleStencilUpdates(const bool &enable_stencil_updates) {
   if (enable_stencil_updates == ctx_.enable_stencil_updates) {
     return;
   }
-  if (enable_stencil_updates) {
-    glStencilMask(0xFF);
-  } else {
-    glStencilMask(0x00);
-  }
+  gl_core_->StencilMask(enable_stencil_updates ? 0xFF : 0x00);
   ctx_.enable_stencil_updates = enable_stencil_updates;
   DEBUG("Stencil updates enabled: {}", enable_stencil_updates);
 }
@@ -246,12 +405,10 @@ void GlfwWindow::ToggleAlphaBlending(const bool &enable_alpha_blending) {
     return;
   }
 
+  gl_core_->SetCapability(GL_BLEND, enable_alpha_blending);
   if (enable_alpha_blending) {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBlendEquation(GL_FUNC_ADD);
-  } else {
-    glDisable(GL_BLEND);
+    gl_core_->BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl_core_->BlendEquation(GL_FUNC_ADD);
   }
   ctx_.enable_alpha_blending = enable_alpha_blending;
   DEBUG("Alpha blending enabled: {}", enable_alpha_blending);
@@ -263,11 +420,9 @@ void GlfwWindow::ToggleFaceCull(const bool &enable_face_cull,
     return;
   }
 
+  gl_core_->SetCapability(GL_CULL_FACE, enable_face_cull);
   if (enable_face_cull) {
-    glEnable(GL_CULL_FACE);
-    glCullFace(face_cull_setting);
-  } else {
-    glDisable(GL_CULL_FACE);
+    gl_core_->CullFace(face_cull_setting);
   }
   ctx_.enable_face_cull = enable_face_cull;
   DEBUG("Face culling enabled: {}", enable_face_cull);
@@ -278,11 +433,8 @@ void GlfwWindow::ToggleSeamlessCubemap(const bool &enable_seamless_cubemap) {
     return;
   }
 
-  if (enable_seamless_cubemap) {
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-  } else {
-    glDisable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-  }
+  gl_core_->SetCapability(GL_TEXTURE_CUBE_MAP_SEAMLESS,
+                          enable_seamless_cubemap);
   ctx_.enable_seamless_cubemap = enable_seamless_cubemap;
   DEBUG("Seamless cubemap enabled: {}", enable_seamless_cubemap);
 }
@@ -294,15 +446,31 @@ float GlfwWindow::GetAspectRatio() {
 
 void GlfwWindow::FramebufferSizeCallback(GLFWwindow * /*window*/,
                                          const int width, const int height) {
+  if (IsHeadless() && width > 0 && height > 0) {
+    CreateOffscreenFramebuffer(Size2D(width, height));
+  }
   SetViewportSize(Size2D(width, height));
 }
 
 void GlfwWindow::DebugUI() {
   fps_tracker_.DebugUI();
+  frame_pacer_.DebugUI();
+  gl_core_->DebugUI();
+  UniformRing::Get().DebugUI();
 
   GlfwWindowContext ctx = ctx_;
   if (ImGui::CollapsingHeader("OpenGL Window",
                               ImGuiTreeNodeFlags_DefaultOpen)) {
+    const GLExtensions &extensions = GLExtensions::Get();
+    ImGui::Text("OpenGL %d.%d, multi-draw-indirect: %s",
+                extensions.MajorVersion(), extensions.MinorVersion(),
+                extensions.SupportsMultiDrawIndirect() ? "yes" : "no");
+    ImGui::Text("Parallel shader compile: %s",
+                extensions.SupportsParallelShaderCompile() ? "yes" : "no");
+    if (IsHeadless()) {
+      ImGui::Text("Headless (%s), %dx%d offscreen", context_api_name_,
+                  offscreen_size_.Width(), offscreen_size_.Height());
+    }
 
     if (ImGui::Checkbox("Enable VSync", &ctx.enable_vsync)) {
       ToggleVsync(ctx.enable_vsync);
@@ -2,12 +2,19 @@
 
 #include "util/macros.h"
 
+#include "engine/core/frame_pacer.h"
 #include "engine/core/frame_util.h"
+#include "engine/core/gl_core.h"
+#include "engine/core/gl_ext.h"
+#include "engine/core/gpu_profiler.h"
+#include "engine/core/uniform_ring.h"
 #include "util/report/report.h"
 
 #include "engine/core/input.h"
 #include "engine/core/types.h"
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace gib {
 
@@ -26,6 +33,25 @@ enum FaceCullMode : GLenum {
   FRONT = GL_FRONT,
 };
 
+// Where the window renders to.
+enum class GlfwWindowBackend : unsigned char {
+  // Visible window on the primary monitor.
+  WINDOWED = 0,
+  // No display needed: GLFW null platform with an EGL surfaceless (or OSMesa)
+  // context, e.g. Mesa llvmpipe on CI machines. Renders into an offscreen
+  // FBO that stays bound as the draw framebuffer.
+  HEADLESS = 1,
+};
+
+// OpenGL context version requested from GLFW.
+enum class GlContextVersion : unsigned char {
+  // Baseline, the newest version macOS offers.
+  GL_4_1 = 0,
+  // Enables multi-draw-indirect batching. Falls back to 4.1 if the driver
+  // cannot create a 4.6 context.
+  GL_4_6 = 1,
+};
+
 // Context for the Glfw window.
 // Handles Glfw window, its properties, and inputs.
 class GlfwWindow {
@@ -47,9 +73,13 @@ class GlfwWindow {
   };
 
 public:
-  explicit GlfwWindow(std::string title,
-                      Size2D size = {kDefaultWidth, kDefaultHeight},
-                      int samples = 0, float fps_report_dt = 5.f);
+  // All GL state changes of the window go through `gl_core`. The context is
+  // created with `gl_version` if the driver supports it, 4.1 otherwise.
+  GlfwWindow(std::shared_ptr<GLCore> gl_core, std::string title,
+             GlfwWindowBackend backend = GlfwWindowBackend::WINDOWED,
+             GlContextVersion gl_version = GlContextVersion::GL_4_1,
+             Size2D size = {kDefaultWidth, kDefaultHeight}, int samples = 0,
+             float fps_report_dt = 5.f);
 
   ~GlfwWindow();
 
@@ -62,12 +92,41 @@ public:
   // Returns True if GFLW is initialized.
   [[nodiscard]] bool IsInit() const { return glfw_init_success_ == GLFW_TRUE; }
 
+  [[nodiscard]] GLCore &GetGLCore() { return *gl_core_; }
+
   // Returns pointer to GLFW window.
   [[nodiscard]] GLFWwindow *GetGlfwWindowPtr();
 
   // Returns average FPS.
   [[nodiscard]] const float GetAvgFps() const;
 
+  [[nodiscard]] bool IsHeadless() const {
+    return backend_ == GlfwWindowBackend::HEADLESS;
+  }
+
+  // Framebuffer the frame is rendered into, 0 (default framebuffer) unless
+  // headless. Code that rebinds the default framebuffer must bind this one.
+  [[nodiscard]] GLuint GetFramebufferId() const { return offscreen_fbo_; }
+
+  // Presents the frame, collects GPU zone timings (passing the frame's GPU
+  // time to the frame pacer) and GL state cache stats and moves the uniform
+  // ring to the next frame. Headless windows have nothing to present and only
+  // flush.
+  void SwapBuffers();
+
+  // Reads back the current framebuffer as tightly packed RGBA8 rows, bottom
+  // row first, e.g. for golden-frame tests.
+  [[nodiscard]] std::vector<unsigned char> ReadFramebufferPixels();
+
+  // Frame time percentiles, exported as JSON on exit if a path is set.
+  [[nodiscard]] FpsTracker &GetFpsTracker() { return fps_tracker_; }
+  void SetFrameStatsExportPath(const std::string &path) {
+    fps_tracker_.SetJsonExportPath(path);
+  }
+
+  // Frame pacing and latency tracking, driven by the render loop.
+  [[nodiscard]] FramePacer &GetFramePacer() { return frame_pacer_; }
+
   void Tick(const FrameTick &frame_tick);
 
   [[nodiscard]] Size2D GetWindowSize();
@@ -100,9 +159,22 @@ public:
 private:
   void FramebufferSizeCallback(GLFWwindow *window, int width, int height);
 
+  // Creates the window with a `major`.`minor` context, or returns nullptr.
+  GLFWwindow *CreateWindowWithContext(const Size2D &size, int major,
+                                      int minor);
+  // Creates the headless window, trying EGL surfaceless first and OSMesa
+  // second. Returns nullptr if neither works.
+  GLFWwindow *CreateHeadlessWindow(const Size2D &size);
+  // (Re)creates the offscreen framebuffer used by the headless backend.
+  void CreateOffscreenFramebuffer(const Size2D &size);
+  void DeleteOffscreenFramebuffer();
+
+  std::shared_ptr<GLCore> gl_core_;
   const std::string title_;
+  const GlfwWindowBackend backend_;
   bool context_initialized_{false};
   FpsTracker fps_tracker_;
+  FramePacer frame_pacer_;
 
   GLFWwindow *glfw_window_ptr_{nullptr};
   GLFWmonitor *monitor_{nullptr};
@@ -117,6 +189,14 @@ private:
   int glfw_init_success_{GLFW_FALSE};
 
   GlfwWindowContext ctx_;
+
+  // Offscreen render target of the headless backend.
+  GLuint offscreen_fbo_{0};
+  GLuint offscreen_color_{0};
+  GLuint offscreen_depth_stencil_{0};
+  Size2D offscreen_size_{0, 0};
+  // GLFW context creation API that succeeded, for the DebugUI.
+  const char *context_api_name_{"native"};
 };
 
 } // namespace gib
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "third_party/glad/glad.h"
+#include "third_party/imgui/imgui.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+#include "util/time/time.h"
+
+#ifdef TRACY_ENABLE
+#include <tracy/TracyOpenGL.hpp>
+#endif
+
+namespace gib {
+
+// Frames a GPU query result is given to become available before it is read
+// back. Results are always read kGpuQueryLatency - 1 frames late, so reading
+// them never stalls the CPU.
+static constexpr size_t kGpuQueryLatency = 3;
+// Smoothing factor of the average GPU zone time.
+static constexpr float kGpuZoneAvgAlpha = 0.05f;
+
+// Times GPU work between scopes using GL_TIMESTAMP queries.
+//
+// Every scope records a timestamp query at its start and end. Unlike
+// GL_TIME_ELAPSED queries, timestamps may nest. Queries are pooled per frame
+// and the pools are triple buffered: Collect() reads the results of the frame
+// issued kGpuQueryLatency - 1 frames ago and reuses its queries.
+//
+// BeginFrame() and EndFrame() additionally time the whole frame, which
+// Collect() returns, e.g. as the GPU cost used by FramePacer.
+//
+// When Tracy is enabled the scopes are forwarded to Tracy's GPU zones instead
+// and nothing is recorded here. Frames are timed either way.
+//
+// Must only be used from the thread owning the GL context.
+class GpuProfiler {
+public:
+  // Process-wide profiler used by PROFILE_GPU_SCOPE_N.
+  static GpuProfiler &Get() {
+    static GpuProfiler profiler;
+    return profiler;
+  }
+
+  // Call once after the GL context is created and loaded.
+  void Init() {
+#ifdef TRACY_ENABLE
+    TracyGpuContext;
+#endif
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    enabled_ = bits > 0;
+    if (!enabled_) {
+      WARNING("GL_TIMESTAMP queries are not supported, GPU zones disabled");
+    }
+  }
+
+  // Call before the first and after the last GL command of the frame.
+  void BeginFrame() {
+    if (!enabled_) {
+      return;
+    }
+    Frame &frame = frames_[frame_index_];
+    frame.begin_query = NextQuery(frame);
+    glQueryCounter(frame.queries[frame.begin_query], GL_TIMESTAMP);
+  }
+  void EndFrame() {
+    if (!enabled_) {
+      return;
+    }
+    Frame &frame = frames_[frame_index_];
+    frame.end_query = NextQuery(frame);
+    glQueryCounter(frame.queries[frame.end_query], GL_TIMESTAMP);
+    frame.timed = true;
+  }
+
+  // `name` must outlive the profiler, e.g. a string literal.
+  void BeginZone(const char *name) {
+    if (!enabled_) {
+      return;
+    }
+    Frame &frame = frames_[frame_index_];
+    frame.zones.push_back({name, depth_, NextQuery(frame), 0});
+    glQueryCounter(frame.queries[frame.zones.back().begin_query], GL_TIMESTAMP);
+    open_zones_.push_back(frame.zones.size() - 1);
+    ++depth_;
+  }
+
+  void EndZone() {
+    if (!enabled_ || open_zones_.empty()) {
+      return;
+    }
+    Frame &frame = frames_[frame_index_];
+    ZoneQueries &zone = frame.zones[open_zones_.back()];
+    open_zones_.pop_back();
+    --depth_;
+    zone.end_query = NextQuery(frame);
+    glQueryCounter(frame.queries[zone.end_query], GL_TIMESTAMP);
+  }
+
+  // Call once per frame after swapping buffers. Returns the GPU time between
+  // BeginFrame() and EndFrame() of the frame read back, if it was timed and
+  // its results were available.
+  std::optional<time_util::DurationUsec> Collect() {
+#ifdef TRACY_ENABLE
+    TracyGpuCollect;
+#endif
+    if (!enabled_) {
+      return std::nullopt;
+    }
+    ASSERT(open_zones_.empty(), "{} GPU zones still open at end of frame",
+           open_zones_.size());
+    frame_index_ = (frame_index_ + 1) % kGpuQueryLatency;
+    return ReadBack(frames_[frame_index_]);
+  }
+
+  // Deletes all queries. Must be called while the GL context is alive.
+  void Release() {
+    for (Frame &frame : frames_) {
+      if (!frame.queries.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(frame.queries.size()),
+                        frame.queries.data());
+      }
+      frame.queries.clear();
+      frame.zones.clear();
+      frame.next_query = 0;
+      frame.timed = false;
+    }
+    open_zones_.clear();
+    depth_ = 0;
+    enabled_ = false;
+  }
+
+  void DebugUI() {
+    if (!ImGui::CollapsingHeader("GPU Zones")) {
+      return;
+    }
+#ifdef TRACY_ENABLE
+    ImGui::TextUnformatted("GPU zones are reported to Tracy.");
+#else
+    if (!enabled_) {
+      ImGui::TextUnformatted("GPU timer queries unavailable.");
+      return;
+    }
+    ImGui::Text("Dropped results: %zu", dropped_frames_);
+    if (!ImGui::BeginTable("gpu_zones", 4,
+                           ImGuiTableFlags_Borders |
+                               ImGuiTableFlags_SizingFixedFit)) {
+      return;
+    }
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("ms");
+    ImGui::TableSetupColumn("avg ms");
+    ImGui::TableSetupColumn("max ms");
+    ImGui::TableHeadersRow();
+    for (const ZoneStats &stats : stats_) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Indent(10.f * static_cast<float>(stats.depth) + 1.f);
+      ImGui::TextUnformatted(stats.name);
+      ImGui::Unindent(10.f * static_cast<float>(stats.depth) + 1.f);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", stats.last_ms);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", stats.avg_ms);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", stats.max_ms);
+    }
+    ImGui::EndTable();
+    if (ImGui::Button("Reset max")) {
+      for (ZoneStats &stats : stats_) {
+        stats.max_ms = 0.f;
+      }
+    }
+#endif
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(GpuProfiler);
+
+private:
+  GpuProfiler() = default;
+  ~GpuProfiler() = default;
+
+  struct ZoneQueries {
+    const char *name;
+    int depth;
+    size_t begin_query;
+    size_t end_query;
+  };
+
+  // Queries and zones issued during one frame.
+  struct Frame {
+    std::vector<GLuint> queries;
+    size_t next_query{0};
+    std::vector<ZoneQueries> zones;
+    // Frame timestamps, valid if `timed`.
+    size_t begin_query{0};
+    size_t end_query{0};
+    bool timed{false};
+  };
+
+  struct ZoneStats {
+    const char *name;
+    int depth;
+    float last_ms{0.f};
+    float avg_ms{0.f};
+    float max_ms{0.f};
+  };
+
+  static size_t NextQuery(Frame &frame) {
+    if (frame.next_query == frame.queries.size()) {
+      GLuint query = 0;
+      glGenQueries(1, &query);
+      frame.queries.push_back(query);
+    }
+    return frame.next_query++;
+  }
+
+  // Reads the results of `frame` and resets it for reuse. Results that are
+  // still not available are dropped rather than waited for. Returns the frame
+  // time if the frame was timed.
+  std::optional<time_util::DurationUsec> ReadBack(Frame &frame) {
+    std::optional<time_util::DurationUsec> frame_time;
+    if (frame.next_query > 0) {
+      GLint available = GL_FALSE;
+      glGetQueryObjectiv(frame.queries[frame.next_query - 1],
+                         GL_QUERY_RESULT_AVAILABLE, &available);
+      if (available == GL_TRUE) {
+        for (const ZoneQueries &zone : frame.zones) {
+          const GLuint64 ns = QueryResult(frame, zone.end_query) -
+                              QueryResult(frame, zone.begin_query);
+          RecordZone(zone, 1e-6f * static_cast<float>(ns));
+        }
+        if (frame.timed) {
+          frame_time = time_util::to_usec(time_util::DurationNsec(
+              QueryResult(frame, frame.end_query) -
+              QueryResult(frame, frame.begin_query)));
+        }
+      } else {
+        ++dropped_frames_;
+      }
+    }
+    frame.next_query = 0;
+    frame.zones.clear();
+    frame.timed = false;
+    return frame_time;
+  }
+
+  static GLuint64 QueryResult(const Frame &frame, const size_t query) {
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(frame.queries[query], GL_QUERY_RESULT, &ns);
+    return ns;
+  }
+
+  void RecordZone(const ZoneQueries &zone, const float ms) {
+    auto it = std::find_if(stats_.begin(), stats_.end(),
+                           [&zone](const ZoneStats &stats) {
+                             return std::strcmp(stats.name, zone.name) == 0;
+                           });
+    if (it == stats_.end()) {
+      stats_.push_back({zone.name, zone.depth, ms, ms, ms});
+      return;
+    }
+    it->depth = zone.depth;
+    it->last_ms = ms;
+    it->avg_ms += kGpuZoneAvgAlpha * (ms - it->avg_ms);
+    it->max_ms = std::max(it->max_ms, ms);
+  }
+
+  bool enabled_{false};
+  std::array<Frame, kGpuQueryLatency> frames_;
+  size_t frame_index_{0};
+  // Indices into the current frame's zones of scopes not yet ended.
+  std::vector<size_t> open_zones_;
+  int depth_{0};
+
+  // Per zone name, in order of first appearance.
+  std::vector<ZoneStats> stats_;
+  size_t dropped_frames_{0};
+};
+
+// RAII GPU zone, see PROFILE_GPU_SCOPE_N.
+class GpuProfileScope {
+public:
+  explicit GpuProfileScope(const char *name) {
+    GpuProfiler::Get().BeginZone(name);
+  }
+  ~GpuProfileScope() { GpuProfiler::Get().EndZone(); }
+
+  DISALLOW_COPY_AND_ASSIGN(GpuProfileScope);
+};
+
+} // namespace gib
+
+#define GIB_GPU_SCOPE_CONCAT_IMPL(a, b) a##b
+#define GIB_GPU_SCOPE_CONCAT(a, b) GIB_GPU_SCOPE_CONCAT_IMPL(a, b)
+
+// GPU counterpart of PROFILE_SCOPE_N, times the GL commands issued until the
+// end of the enclosing scope. `name` must be a string literal.
+#ifdef TRACY_ENABLE
+#define PROFILE_GPU_SCOPE_N(name) TracyGpuZone(name)
+#else
+#define PROFILE_GPU_SCOPE_N(name)                                              \
+  ::gib::GpuProfileScope GIB_GPU_SCOPE_CONCAT(gpu_profile_scope_,            \
+                                              __LINE__)(name)
+#endif
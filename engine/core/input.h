@@ -2,17 +2,22 @@
 
 #include "util/macros.h"
 #include "util/report/report.h"
+#include "util/time/time.h"
 #include <array>
+#include <vector>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include "engine/buffer_util/lock_free_spsc_ring.h"
 #include "engine/core/types.h"
 
 // Number of keys.
 static constexpr int kNumKeys = GLFW_KEY_LAST + 1;
 // Number of mouse buttons.
 static constexpr int kNumMouseButtons = GLFW_MOUSE_BUTTON_LAST + 1;
+// Number of input events that can be queued between two consumer reads.
+static constexpr size_t kInputEventQueueSize = 1024;
 
 namespace gib {
 
@@ -43,6 +48,48 @@ enum class MouseButtonAction : unsigned char {
 // Key states.
 enum class KeyAction : unsigned char { UNKNOWN, RELEASE, PRESS, REPEAT };
 
+// Type of a GLFW input callback.
+enum class InputEventType : unsigned char {
+  KEY,
+  MOUSE_BUTTON,
+  MOUSE_MOVE,
+  SCROLL,
+};
+
+// Single GLFW input callback, stamped with the time it was received.
+struct InputEvent {
+  time_util::TimePoint time{};
+  InputEventType type{InputEventType::KEY};
+  // Key or mouse button.
+  int code{0};
+  int scancode{0};
+  int action{0};
+  int mods{0};
+  // Cursor position for MOUSE_MOVE, offset for SCROLL.
+  Offset value{};
+};
+
+// True if `event` can be applied to an Input: a known type, and for keys and
+// mouse buttons a code and action within the state arrays. GLFW reports
+// unknown keys as GLFW_KEY_UNKNOWN (-1).
+inline bool IsValidInputEvent(const InputEvent &event) {
+  switch (event.type) {
+  case InputEventType::KEY:
+    return event.code >= 0 && event.code < kNumKeys &&
+           event.action >= GLFW_RELEASE && event.action <= GLFW_REPEAT;
+  case InputEventType::MOUSE_BUTTON:
+    return event.code >= 0 && event.code < kNumMouseButtons &&
+           event.action >= GLFW_RELEASE && event.action <= GLFW_PRESS;
+  case InputEventType::MOUSE_MOVE:
+  case InputEventType::SCROLL:
+    return true;
+  }
+  return false;
+}
+
+// Queue handing input events from the GLFW callbacks to the simulation.
+using InputEventQueue = LockFreeSpscRing<InputEvent, kInputEventQueueSize>;
+
 // Struct containing input state.
 struct Input {
   std::array<KeyAction, kNumKeys> key_state{};
@@ -51,7 +98,38 @@ struct Input {
   Offset mouse_pos{};
   Offset scroll_offset{};
 
-  void Reset() { scroll_offset = {0.f, 0.f}; }
+  // Events applied since the last Reset(), in arrival order. Unlike the state
+  // above, this keeps press/release pairs and mouse samples that happen within
+  // one frame or tick.
+  std::vector<InputEvent> events;
+
+  void Reset() {
+    scroll_offset = {0.f, 0.f};
+    events.clear();
+  }
+
+  // Updates the input state with the given event and records it. Invalid
+  // events, see IsValidInputEvent(), are dropped.
+  void Apply(const InputEvent &event) {
+    if (!IsValidInputEvent(event)) {
+      return;
+    }
+    switch (event.type) {
+    case InputEventType::KEY:
+      KeyCallback(event.code, event.scancode, event.action, event.mods);
+      break;
+    case InputEventType::MOUSE_BUTTON:
+      MouseButtonCallback(event.code, event.action, event.mods);
+      break;
+    case InputEventType::MOUSE_MOVE:
+      MouseMoveCallback(event.value.x, event.value.y);
+      break;
+    case InputEventType::SCROLL:
+      ScrollCallback(event.value.x, event.value.y);
+      break;
+    }
+    events.push_back(event);
+  }
 
   void KeyCallback(int key, int /*scancode*/, int action, int /*mods*/) {
     key_state[key] = static_cast<KeyAction>(action);
@@ -62,7 +140,9 @@ struct Input {
   }
 
   void ScrollCallback(const double xoffset, const double yoffset) {
-    scroll_offset = {static_cast<float>(xoffset), static_cast<float>(yoffset)};
+    // Accumulate, several scroll events can arrive before the next Reset().
+    scroll_offset +=
+        Offset{static_cast<float>(xoffset), static_cast<float>(yoffset)};
   }
 
   void MouseMoveCallback(const double xpos, const double ypos) {
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "engine/core/frame_util.h"
+#include "engine/core/input.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+#include "util/time/time.h"
+
+namespace gib {
+
+// Input recording file layout, all integers little endian:
+//   header: magic "GIBINPUT", uint32 version
+//   per frame:
+//     int64 frame time (usec since recording start), int64 frame dt (usec),
+//     uint32 event count
+//     per event: int64 time (usec since recording start), uint8 type,
+//                int32 code, scancode, action, mods, float32 value x, y
+//
+// Only input events are stored. Replaying them through Input::Apply()
+// rebuilds the exact per-frame Input state.
+static constexpr char kInputRecordingMagic[8] = {'G', 'I', 'B', 'I',
+                                                 'N', 'P', 'U', 'T'};
+static constexpr uint32_t kInputRecordingVersion = 1;
+// Bytes of one recorded event.
+static constexpr size_t kRecordedEventBytes =
+    sizeof(int64_t) + sizeof(uint8_t) + 4 * sizeof(int32_t) + 2 * sizeof(float);
+
+// Unsigned integer type of `kBytes` bytes.
+template <size_t kBytes>
+using RecordingWord = std::conditional_t<
+    kBytes == 1, uint8_t,
+    std::conditional_t<kBytes == 2, uint16_t,
+                       std::conditional_t<kBytes == 4, uint32_t, uint64_t>>>;
+
+// Writes `value` little endian, whatever the host byte order.
+template <typename T>
+void WriteLittleEndian(std::ostream &stream, const T value) {
+  static_assert(std::is_arithmetic_v<T> && sizeof(T) <= sizeof(uint64_t));
+  RecordingWord<sizeof(T)> word = 0;
+  std::memcpy(&word, &value, sizeof(T));
+  char bytes[sizeof(T)];
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    bytes[i] = static_cast<char>((word >> (8 * i)) & 0xFF);
+  }
+  stream.write(bytes, sizeof(T));
+}
+
+// Reads a value written by WriteLittleEndian(). Returns false on a short
+// read.
+template <typename T> bool ReadLittleEndian(std::istream &stream, T &value) {
+  static_assert(std::is_arithmetic_v<T> && sizeof(T) <= sizeof(uint64_t));
+  unsigned char bytes[sizeof(T)];
+  stream.read(reinterpret_cast<char *>(bytes), sizeof(T));
+  if (!stream) {
+    return false;
+  }
+  RecordingWord<sizeof(T)> word = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    word |= static_cast<RecordingWord<sizeof(T)>>(bytes[i]) << (8 * i);
+  }
+  std::memcpy(&value, &word, sizeof(T));
+  return true;
+}
+
+// Writes per-frame FrameTicks and input events to a file.
+class InputRecorder {
+public:
+  // `start` is the time all recorded times are relative to.
+  InputRecorder(const std::string &path, const time_util::TimePoint start)
+      : file_(path, std::ios::binary | std::ios::trunc), start_(start) {
+    if (!file_) {
+      THROW_FATAL("Failed to open input recording {} for writing", path);
+    }
+    file_.write(kInputRecordingMagic, sizeof(kInputRecordingMagic));
+    Write(kInputRecordingVersion);
+    INFO("Recording input to {}", path);
+  }
+  ~InputRecorder() { DEBUG("Recorded {} frames of input", frame_count_); }
+
+  // Call once per frame with the events received since the previous frame.
+  void RecordFrame(const FrameTick &tick,
+                   const std::vector<InputEvent> &events) {
+    Write(ToOffset(tick.current_time));
+    Write(static_cast<int64_t>(tick.delta_time.count()));
+    Write(static_cast<uint32_t>(events.size()));
+    for (const InputEvent &event : events) {
+      Write(ToOffset(event.time));
+      Write(static_cast<uint8_t>(event.type));
+      Write(static_cast<int32_t>(event.code));
+      Write(static_cast<int32_t>(event.scancode));
+      Write(static_cast<int32_t>(event.action));
+      Write(static_cast<int32_t>(event.mods));
+      Write(event.value.x);
+      Write(event.value.y);
+    }
+    ++frame_count_;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(InputRecorder);
+
+private:
+  template <typename T> void Write(const T value) {
+    WriteLittleEndian(file_, value);
+  }
+
+  [[nodiscard]] int64_t ToOffset(const time_util::TimePoint time) const {
+    return time_util::elapsed_usec(start_, time).count();
+  }
+
+  std::ofstream file_;
+  const time_util::TimePoint start_;
+  size_t frame_count_{0};
+};
+
+// Reads back a file written by InputRecorder, one frame at a time.
+class InputReplayer {
+public:
+  // Recorded times are replayed relative to `start`. With `fixed_dt`, frame
+  // times advance by exactly that much per frame instead of the recorded dt,
+  // and events are stamped with their frame's time.
+  InputReplayer(const std::string &path, const time_util::TimePoint start,
+                const std::optional<time_util::DurationUsec> fixed_dt)
+      : file_(path, std::ios::binary), start_(start), fixed_dt_(fixed_dt) {
+    if (!file_) {
+      THROW_FATAL("Failed to open input recording {}", path);
+    }
+    file_.seekg(0, std::ios::end);
+    file_size_ = static_cast<int64_t>(file_.tellg());
+    file_.seekg(0, std::ios::beg);
+    char magic[sizeof(kInputRecordingMagic)] = {};
+    file_.read(magic, sizeof(magic));
+    uint32_t version = 0;
+    if (!file_ ||
+        std::memcmp(magic, kInputRecordingMagic, sizeof(magic)) != 0 ||
+        !Read(version) || version != kInputRecordingVersion) {
+      THROW_FATAL("{} is not a version {} input recording", path,
+                  kInputRecordingVersion);
+    }
+    INFO("Replaying input from {}", path);
+  }
+
+  // Reads the next frame. Returns std::nullopt at the end of the recording.
+  // `events` is replaced with the frame's events. Throws on a corrupt
+  // recording rather than applying events it cannot trust.
+  std::optional<FrameTick> NextFrame(std::vector<InputEvent> &events) {
+    int64_t frame_time = 0;
+    int64_t frame_dt = 0;
+    uint32_t event_count = 0;
+    if (!Read(frame_time) || !Read(frame_dt) || !Read(event_count)) {
+      return std::nullopt;
+    }
+    if (fixed_dt_.has_value()) {
+      frame_dt = fixed_dt_->count();
+      frame_time = static_cast<int64_t>(frame_count_ + 1) * frame_dt;
+    }
+    const time_util::TimePoint current_time =
+        start_ + time_util::DurationUsec(frame_time);
+
+    // Checked before allocating, a corrupt count could ask for gigabytes.
+    const int64_t remaining = file_size_ - static_cast<int64_t>(file_.tellg());
+    if (static_cast<uint64_t>(event_count) * kRecordedEventBytes >
+        static_cast<uint64_t>(remaining)) {
+      THROW_FATAL("Input recording frame {} claims {} events, only {} bytes "
+                  "left",
+                  frame_count_, event_count, remaining);
+    }
+    events.resize(event_count);
+    for (InputEvent &event : events) {
+      int64_t time = 0;
+      uint8_t type = 0;
+      int32_t code = 0;
+      int32_t scancode = 0;
+      int32_t action = 0;
+      int32_t mods = 0;
+      if (!Read(time) || !Read(type) || !Read(code) || !Read(scancode) ||
+          !Read(action) || !Read(mods) || !Read(event.value.x) ||
+          !Read(event.value.y)) {
+        THROW_FATAL("Input recording truncated in frame {}", frame_count_);
+      }
+      if (type > static_cast<uint8_t>(InputEventType::SCROLL)) {
+        THROW_FATAL("Unknown input event type {} in frame {}", type,
+                    frame_count_);
+      }
+      event.time = fixed_dt_.has_value()
+                       ? current_time
+                       : start_ + time_util::DurationUsec(time);
+      event.type = static_cast<InputEventType>(type);
+      event.code = code;
+      event.scancode = scancode;
+      event.action = action;
+      event.mods = mods;
+      if (!IsValidInputEvent(event)) {
+        THROW_FATAL("Input event with code {}, action {} out of range in "
+                    "frame {}",
+                    code, action, frame_count_);
+      }
+    }
+    ++frame_count_;
+    return FrameTick{current_time, time_util::DurationUsec(frame_dt)};
+  }
+
+  [[nodiscard]] size_t FrameCount() const { return frame_count_; }
+
+  DISALLOW_COPY_AND_ASSIGN(InputReplayer);
+
+private:
+  template <typename T> bool Read(T &value) {
+    return ReadLittleEndian(file_, value);
+  }
+
+  std::ifstream file_;
+  int64_t file_size_{0};
+  const time_util::TimePoint start_;
+  const std::optional<time_util::DurationUsec> fixed_dt_;
+  size_t frame_count_{0};
+};
+
+} // namespace gib
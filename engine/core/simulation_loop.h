@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "engine/buffer_util/snapshot_history.h"
+#include "engine/core/frame_util.h"
+#include "engine/core/input.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+#include "util/time/time.h"
+
+#include "third_party/imgui/imgui.h"
+
+namespace gib {
+
+// Default simulation tick rate.
+static constexpr float kDefaultSimulationRateHz = 128.f;
+// Maximum number of ticks run back-to-back to catch up after a stall. Any
+// time beyond that is dropped instead of spiralling.
+static constexpr int kMaxCatchUpTicks = 8;
+
+// Runs a fixed-timestep simulation on a dedicated thread.
+//
+// The simulation thread owns the authoritative state and advances it by a
+// fixed dt on every tick. After each tick the state is published with its tick
+// time into a SnapshotHistory, so the render thread can read (or interpolate
+// between) the latest snapshots without blocking the simulation and vice
+// versa. Input flows the other way as timestamped events, each tick applies
+// exactly the events that arrived before its tick time.
+//
+// Ticks follow the wall clock by default. Started with an external clock, the
+// loop only runs the ticks RunUntil() allows, e.g. to follow the clock of an
+// input replay so every run applies the same events to the same ticks.
+template <typename StateType> class SimulationLoop {
+public:
+  // Advances `state` by one tick. Runs on the simulation thread, so it must
+  // not touch GL or ImGui.
+  using TickFn =
+      std::function<void(const FrameTick &, const Input &, StateType &)>;
+
+  explicit SimulationLoop(const float rate_hz = kDefaultSimulationRateHz)
+      : rate_hz_(rate_hz),
+        tick_dt_(time_util::seconds_to_usec(1.f / rate_hz)) {
+    ASSERT(rate_hz > 0.f, "Simulation rate must be > 0, got {}", rate_hz);
+  }
+  ~SimulationLoop() { Stop(); }
+
+  // Spawns the simulation thread. `initial_state` seeds the authoritative
+  // state and is published before the first tick. With
+  // `external_clock_start`, the clock starts at that time and only advances
+  // through RunUntil().
+  void Start(TickFn tick_fn, const StateType &initial_state = StateType{},
+             const std::optional<time_util::TimePoint> external_clock_start =
+                 std::nullopt) {
+    ASSERT(!running_.load(std::memory_order_relaxed),
+           "Simulation loop already running");
+    tick_fn_ = std::move(tick_fn);
+    state_ = initial_state;
+    external_clock_ = external_clock_start.has_value();
+    const time_util::TimePoint start =
+        external_clock_start.value_or(time_util::now());
+    snapshots_.Write() = state_;
+    snapshots_.Commit(start);
+
+    running_.store(true, std::memory_order_release);
+    if (external_clock_) {
+      // The initial snapshot is the state at `start`.
+      clock_ = start;
+      next_tick_ = start + tick_dt_;
+      thread_ = std::thread([this]() { ExternalClockLoop(); });
+    } else {
+      thread_ = std::thread([this]() { Loop(); });
+    }
+    INFO("Simulation thread started at {} Hz{}", rate_hz_,
+         external_clock_ ? " on an external clock" : "");
+  }
+
+  // Signals the simulation thread to exit and joins it.
+  void Stop() {
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+      return;
+    }
+    {
+      // Wakes the thread if it waits for the external clock.
+      std::lock_guard<std::mutex> lock(clock_mutex_);
+    }
+    clock_changed_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    INFO("Simulation thread stopped after {} ticks",
+         tick_count_.load(std::memory_order_relaxed));
+  }
+
+  [[nodiscard]] bool IsRunning() const {
+    return running_.load(std::memory_order_acquire);
+  }
+
+  // Externally clocked loops only. Advances the clock to `time` and blocks
+  // until every tick at or before it is published. Input events must be
+  // pushed before the clock passes their time.
+  void RunUntil(const time_util::TimePoint time) {
+    ASSERT(external_clock_, "RunUntil() needs an externally clocked loop");
+    std::unique_lock<std::mutex> lock(clock_mutex_);
+    clock_ = std::max(clock_, time);
+    clock_changed_.notify_all();
+    clock_changed_.wait(lock, [this]() {
+      return next_tick_ > clock_ || !running_.load(std::memory_order_acquire);
+    });
+  }
+
+  // Called by the thread running the GLFW callbacks for every input event.
+  void PushInputEvent(const InputEvent &event) {
+    if (!input_events_.TryPush(event)) {
+      dropped_input_events_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Called by the render thread. Pulls the newest published snapshot into the
+  // history and returns it. Snapshots are stamped with their FrameTick time.
+  const SnapshotHistory<StateType> &UpdateSnapshots() {
+    snapshots_.Update();
+    return snapshots_;
+  }
+
+  [[nodiscard]] float RateHz() const { return rate_hz_; }
+  [[nodiscard]] time_util::DurationUsec TickDt() const { return tick_dt_; }
+
+  void DebugUI() {
+    if (ImGui::CollapsingHeader("Simulation",
+                                ImGuiTreeNodeFlags_DefaultOpen)) {
+      ImGui::Text("Rate: %.1f Hz (dt %.3f ms)", rate_hz_,
+                  1e-3f * static_cast<float>(tick_dt_.count()));
+      ImGui::Text("Ticks: %llu",
+                  static_cast<unsigned long long>(
+                      tick_count_.load(std::memory_order_relaxed)));
+      ImGui::Text("Last tick cost: %.3f ms",
+                  1e-3f * static_cast<float>(
+                              last_tick_cost_usec_.load(
+                                  std::memory_order_relaxed)));
+      ImGui::Text("Dropped ticks: %llu",
+                  static_cast<unsigned long long>(
+                      dropped_ticks_.load(std::memory_order_relaxed)));
+      ImGui::Text("Dropped input events: %llu",
+                  static_cast<unsigned long long>(
+                      dropped_input_events_.load(std::memory_order_relaxed)));
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(SimulationLoop);
+
+private:
+  void Loop() {
+    Input input{};
+    time_util::TimePoint next_tick = time_util::now();
+
+    while (running_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_until(next_tick);
+
+      // Catch up on ticks we are late for, but never more than
+      // kMaxCatchUpTicks in a row.
+      int ticks_run = 0;
+      while (time_util::now() >= next_tick && ticks_run < kMaxCatchUpTicks) {
+        RunTick(next_tick, input);
+        next_tick += tick_dt_;
+        ++ticks_run;
+      }
+
+      if (ticks_run == kMaxCatchUpTicks && time_util::now() >= next_tick) {
+        // Too far behind, drop the backlog and resync to the wall clock.
+        const auto behind = time_util::elapsed_usec(next_tick);
+        const auto dropped = behind.count() / tick_dt_.count() + 1;
+        dropped_ticks_.fetch_add(static_cast<uint64_t>(dropped),
+                                 std::memory_order_relaxed);
+        next_tick += tick_dt_ * dropped;
+      }
+      PROFILE_FRAME("Simulation");
+    }
+  }
+
+  // Runs every tick the external clock has reached, none are dropped.
+  void ExternalClockLoop() {
+    Input input{};
+    std::unique_lock<std::mutex> lock(clock_mutex_);
+    while (true) {
+      clock_changed_.wait(lock, [this]() {
+        return next_tick_ <= clock_ ||
+               !running_.load(std::memory_order_acquire);
+      });
+      if (!running_.load(std::memory_order_acquire)) {
+        return;
+      }
+      const time_util::TimePoint tick_time = next_tick_;
+      lock.unlock();
+      RunTick(tick_time, input);
+      lock.lock();
+      next_tick_ += tick_dt_;
+      clock_changed_.notify_all();
+    }
+  }
+
+  // Runs the tick at `tick_time` and publishes its snapshot.
+  void RunTick(const time_util::TimePoint tick_time, Input &input) {
+    PROFILE_SCOPE_N("SimulationLoop::Tick");
+    const time_util::TimePoint tick_start = time_util::now();
+
+    // Apply the events that arrived before this tick, in order. Later events
+    // stay queued for the following ticks.
+    input.Reset();
+    for (const InputEvent *event = input_events_.Front();
+         event != nullptr && event->time < tick_time;
+         event = input_events_.Front()) {
+      input.Apply(*event);
+      input_events_.Pop();
+    }
+
+    const FrameTick tick{tick_time, tick_dt_};
+    tick_fn_(tick, input, state_);
+
+    snapshots_.Write() = state_;
+    snapshots_.Commit(tick.current_time);
+
+    tick_count_.fetch_add(1, std::memory_order_relaxed);
+    last_tick_cost_usec_.store(time_util::elapsed_usec(tick_start).count(),
+                               std::memory_order_relaxed);
+  }
+
+  const float rate_hz_;
+  const time_util::DurationUsec tick_dt_;
+
+  TickFn tick_fn_;
+  // Owned by the simulation thread while running.
+  StateType state_{};
+
+  SnapshotHistory<StateType> snapshots_;
+  InputEventQueue input_events_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+
+  // External clock, see RunUntil().
+  bool external_clock_{false};
+  std::mutex clock_mutex_;
+  std::condition_variable clock_changed_;
+  // Guarded by `clock_mutex_`.
+  time_util::TimePoint clock_;
+  time_util::TimePoint next_tick_;
+
+  // Stats, written by the simulation thread and read by the UI.
+  std::atomic<uint64_t> tick_count_{0};
+  std::atomic<uint64_t> dropped_ticks_{0};
+  std::atomic<uint64_t> dropped_input_events_{0};
+  std::atomic<int64_t> last_tick_cost_usec_{0};
+};
+
+} // namespace gib
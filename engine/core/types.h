@@ -2,7 +2,11 @@
 
 #include <algorithm>
 #include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 #include <iostream>
 
 namespace gib {
@@ -24,6 +28,28 @@ inline std::string to_string(const Size2D &size) {
                      size.Height());
 }
 
+// Position, rotation and scale of an object.
+struct Transform {
+  glm::vec3 position{0.f};
+  glm::quat rotation{1.f, 0.f, 0.f, 0.f};
+  glm::vec3 scale{1.f};
+
+  [[nodiscard]] glm::mat4 Matrix() const {
+    return glm::translate(glm::mat4(1.f), position) *
+           glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.f), scale);
+  }
+};
+
+// Interpolates between two transforms, slerp for the rotation.
+inline Transform Interpolate(const Transform &from, const Transform &to,
+                             const float alpha) {
+  Transform transform;
+  transform.position = glm::mix(from.position, to.position, alpha);
+  transform.rotation = glm::slerp(from.rotation, to.rotation, alpha);
+  transform.scale = glm::mix(from.scale, to.scale, alpha);
+  return transform;
+}
+
 // Type that holds a value that conforms to a pre-determined minimum and maximum
 // value.
 template <typename ValueType> class BoundedType {
@@ -42,17 +68,18 @@ public:
   BoundedType(const BoundedType &other)
       : value_(other.Get()), max_(other.GetMax()), min_(other.GetMin()) {}
   BoundedType &operator=(const BoundedType &other) {
-    value_ = other.GetValue();
+    value_ = other.Get();
     max_ = other.GetMax();
     min_ = other.GetMin();
+    return *this;
   }
   BoundedType(BoundedType &&other) = delete;
   BoundedType &operator=(BoundedType &&other) = delete;
 
 private:
   ValueType value_;
-  const ValueType max_;
-  const ValueType min_;
+  ValueType max_;
+  ValueType min_;
 };
 
 } // namespace gib
\ No newline at end of file
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "engine/core/gl_core.h"
+#include "engine/core/gl_ext.h"
+#include "third_party/glad/glad.h"
+#include "third_party/imgui/imgui.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+#include "util/time/time.h"
+
+namespace gib {
+
+// Frames the CPU may write ahead of the GPU in the persistent ring.
+static constexpr size_t kUniformRingFrames = 3;
+// Default bytes of uniform data per frame.
+static constexpr size_t kDefaultUniformRingFrameBytes = size_t{4} << 20;
+// Time blocked on a ring region fence before warning about a stalled GPU.
+static constexpr time_util::DurationUsec kUniformRingFenceTimeout{100'000};
+
+// Range of the ring written by one UniformRing::Upload().
+struct UniformRange {
+  GLuint buffer{0};
+  GLintptr offset{0};
+  GLsizeiptr size{0};
+};
+
+// Streams per-frame uniform data (per-draw and per-material blocks) through
+// one large uniform buffer, so nothing needs a buffer object of its own or a
+// glBufferSubData per draw.
+//
+// Upload() bump allocates from the region of the current frame and copies
+// the data in; Bind() binds the range with glBindBufferRange.
+//  - GL 4.4+ (or ARB_buffer_storage): the buffer is mapped once with
+//    GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT and split into
+//    kUniformRingFrames regions. EndFrame() fences the region just written
+//    and waits for the fence of the region about to be reused, which only
+//    blocks if the GPU is kUniformRingFrames frames behind. The wait never
+//    gives up, a region is only rewritten once the GPU is done with it.
+//  - GL 4.1: one region, orphaned with glBufferData(nullptr) every frame and
+//    written through unsynchronized glMapBufferRange.
+//
+// Data uploaded in a frame is only valid until EndFrame(), re-upload it every
+// frame it is used. Must only be used from the thread owning the GL context.
+class UniformRing {
+public:
+  // Process-wide ring, initialized by the window.
+  static UniformRing &Get() {
+    static UniformRing ring;
+    return ring;
+  }
+
+  // Call once after the GL context is created and loaded.
+  void Init(const size_t frame_bytes = kDefaultUniformRingFrameBytes) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment_ = alignment > 0 ? static_cast<size_t>(alignment) : 256;
+    frame_bytes_ = AlignUp(frame_bytes);
+
+    const GLExtensions &extensions = GLExtensions::Get();
+    persistent_ = extensions.SupportsBufferStorage();
+    const size_t regions = persistent_ ? kUniformRingFrames : 1;
+
+    glGenBuffers(1, &buffer_);
+    GLCore::Current().BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    const auto total_bytes = static_cast<GLsizeiptr>(frame_bytes_ * regions);
+    if (persistent_) {
+      constexpr GLbitfield kFlags =
+          GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      extensions.BufferStorage(GL_UNIFORM_BUFFER, total_bytes, nullptr,
+                               kFlags);
+      mapped_ = static_cast<unsigned char *>(
+          glMapBufferRange(GL_UNIFORM_BUFFER, 0, total_bytes, kFlags));
+      if (mapped_ == nullptr) {
+        THROW_FATAL("Failed to persistently map the uniform ring");
+      }
+    } else {
+      glBufferData(GL_UNIFORM_BUFFER, total_bytes, nullptr, GL_STREAM_DRAW);
+    }
+    region_ = 0;
+    used_bytes_ = 0;
+    INFO("Uniform ring: {} KiB per frame, {}", frame_bytes_ >> 10,
+         persistent_ ? "persistent mapped" : "orphaning");
+  }
+
+  // Copies `size` bytes of `data` into the current frame's region.
+  UniformRange Upload(const void *data, const size_t size) {
+    ASSERT(buffer_ != 0, "Uniform ring not initialized");
+    const size_t offset = used_bytes_;
+    ASSERT(offset + size <= frame_bytes_,
+           "Uniform ring region of {} bytes exhausted, raise the frame size",
+           frame_bytes_);
+    used_bytes_ = AlignUp(offset + size);
+
+    const size_t ring_offset = region_ * frame_bytes_ + offset;
+    if (persistent_) {
+      std::memcpy(mapped_ + ring_offset, data, size);
+    } else {
+      // The region was orphaned this frame, so nothing the GPU reads can be
+      // overwritten.
+      GLCore::Current().BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+      void *dst = glMapBufferRange(
+          GL_UNIFORM_BUFFER, static_cast<GLintptr>(ring_offset),
+          static_cast<GLsizeiptr>(size),
+          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+              GL_MAP_UNSYNCHRONIZED_BIT);
+      std::memcpy(dst, data, size);
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    return {buffer_, static_cast<GLintptr>(ring_offset),
+            static_cast<GLsizeiptr>(size)};
+  }
+
+  template <typename T> UniformRange Upload(const T &value) {
+    return Upload(&value, sizeof(T));
+  }
+
+  // Binds `range` to uniform block binding `index`.
+  static void Bind(const GLuint index, const UniformRange &range) {
+    GLCore::Current().BindBufferRange(GL_UNIFORM_BUFFER, index, range.buffer,
+                                      range.offset, range.size);
+  }
+
+  // Call after the last draw of the frame. Moves on to the next region,
+  // waiting for the GPU to be done with it.
+  void EndFrame() {
+    if (buffer_ == 0) {
+      return;
+    }
+    last_frame_bytes_ = used_bytes_;
+    PROFILE_VALUE("Uniform ring (KiB)", used_bytes_ >> 10);
+    used_bytes_ = 0;
+    ++frame_;
+    if (!persistent_) {
+      GLCore::Current().BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+      glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(frame_bytes_),
+                   nullptr, GL_STREAM_DRAW);
+      return;
+    }
+    fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region_ = (region_ + 1) % kUniformRingFrames;
+    WaitForRegion(region_);
+  }
+
+  // Frames ended so far. Data uploaded in an earlier frame is stale.
+  [[nodiscard]] uint64_t Frame() const { return frame_; }
+
+  // Deletes the buffer and fences. Must be called while the GL context is
+  // alive.
+  void Release() {
+    for (GLsync &fence : fences_) {
+      if (fence != nullptr) {
+        glDeleteSync(fence);
+        fence = nullptr;
+      }
+    }
+    if (buffer_ != 0) {
+      if (persistent_) {
+        GLCore::Current().BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+      }
+      GLCore::Current().DeleteBuffer(buffer_);
+      buffer_ = 0;
+      mapped_ = nullptr;
+    }
+  }
+
+  void DebugUI() {
+    if (ImGui::CollapsingHeader("Uniform Ring")) {
+      ImGui::Text("Mode: %s", persistent_ ? "persistent mapped" : "orphaning");
+      ImGui::Text("Last frame: %zu / %zu KiB", last_frame_bytes_ >> 10,
+                  frame_bytes_ >> 10);
+      ImGui::Text("Fence wait: %.3f ms", 1e-3f * fence_wait_usec_);
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(UniformRing);
+
+private:
+  UniformRing() = default;
+
+  [[nodiscard]] size_t AlignUp(const size_t bytes) const {
+    return (bytes + alignment_ - 1) / alignment_ * alignment_;
+  }
+
+  void WaitForRegion(const size_t region) {
+    GLsync &fence = fences_[region];
+    if (fence == nullptr) {
+      return;
+    }
+    const time_util::TimePoint start = time_util::now();
+    // The GPU may still read the region, so overwriting it early would
+    // corrupt in-flight draws. Keep waiting, warning once per timeout.
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (true) {
+      const GLenum status = glClientWaitSync(
+          fence, flags,
+          static_cast<GLuint64>(
+              time_util::to_nsec(kUniformRingFenceTimeout).count()));
+      if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+        break;
+      }
+      if (status == GL_WAIT_FAILED) {
+        THROW_FATAL("Waiting on the uniform ring fence failed");
+      }
+      WARNING("Uniform ring fence not signalled after {} us, still waiting",
+              time_util::elapsed_usec(start).count());
+      // Commands were flushed by the first wait.
+      flags = 0;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+    fence_wait_usec_ =
+        static_cast<float>(time_util::elapsed_usec(start).count());
+  }
+
+  GLuint buffer_{0};
+  unsigned char *mapped_{nullptr};
+  bool persistent_{false};
+  size_t alignment_{256};
+  size_t frame_bytes_{0};
+
+  size_t region_{0};
+  size_t used_bytes_{0};
+  size_t last_frame_bytes_{0};
+  uint64_t frame_{0};
+  std::array<GLsync, kUniformRingFrames> fences_{};
+  float fence_wait_usec_{0.f};
+};
+
+} // namespace gib
@@ -2,39 +2,46 @@
 #include "engine/textures/texture_utils.h"
 
 namespace gib {
-
-static constexpr GLuint kUBOBindingPoint = 3; // keep in sync with GLSL
-
-Material::Material(Shader *shader) : shader_(shader) {
-  glGenBuffers(1, &ubo_);
-  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
-  glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialParams),
-               nullptr, // allocate, fill later
-               GL_DYNAMIC_DRAW);
-  glBindBufferBase(GL_UNIFORM_BUFFER, kUBOBindingPoint, ubo_);
+namespace {
+
+constexpr UniformHandle kMaterialIndex(kMaterialIndexUniform);
+
+// Sampler uniform of `type`, hashed once.
+UniformHandle TextureMapUniform(const TextureMapType type) {
+  static const auto kHandles = [] {
+    std::vector<UniformHandle> handles;
+    for (int i = 0; i <= static_cast<int>(TextureMapType::CUBEMAP); ++i) {
+      handles.emplace_back(
+          TextureMapTypeToString(static_cast<TextureMapType>(i)));
+    }
+    return handles;
+  }();
+  return kHandles[static_cast<size_t>(type)];
 }
 
-void Material::UploadUBO() {
-  if (!dirty_) {
-    return;
-  }
+} // namespace
 
-  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
-  // TODO(rochan): optimize this.
-  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MaterialParams), &params_);
-  dirty_ = false;
+Material::Material(Shader *shader) : Material(shader, MaterialParams{}) {}
+
+Material::Material(Shader *shader, const MaterialParams &params)
+    : shader_(shader), id_(MaterialTable::Current().Allocate()) {
+  SetParams(params);
 }
 
+Material::~Material() { MaterialTable::Current().Free(id_); }
+
 void Material::Bind(TextureRegistry &reg) {
   shader_->Activate();
-  UploadUBO();
+  // Streams the table if it changed, the binding is shared by all materials.
+  MaterialTable::Current().Bind();
+  shader_->SetUint(kMaterialIndex, id_);
 
   for (auto &kv : textures_) {
     unsigned int unit = reg.GetNextTextureUnit();
     kv.second->BindToUnit(unit);
 
     // Uniform name convention:  "u_<MapType>"  (e.g. u_Albedo, u_Normal)
-    shader_->SetInt(TextureMapTypeToChar(kv.first), unit);
+    shader_->SetInt(TextureMapUniform(kv.first), static_cast<int>(unit));
   }
 }
 
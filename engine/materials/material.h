@@ -1,6 +1,8 @@
 #pragma once
 
+#include "engine/core/gl_core.h"
 #include "engine/core/types.h"
+#include "engine/materials/material_table.h"
 #include "engine/textures/texture.h"
 #include "engine/textures/texture_utils.h"
 
@@ -8,23 +10,10 @@
 
 namespace gib {
 
-// Shader usage:
-// layout(std140, binding = 3) uniform MaterialBlock {
-//   vec4 u_BaseColor; // xyz = RGB, w = alpha
-//   float u_Roughness;
-//   float u_Metallic;
-//   float u_Reflectance;
-//   float u_AmbientOcclusion;
-//   float u_Anisotropy;
-//   vec3 u_AnisoDir;     // xyz only
-//   vec4 u_Emissive;     // HDR nits, w = exposure weight
-//   vec3 u_NormalFactor; // usually (1,1,1)
-//   vec3 u_Absorption;   // Beer-Lambert
-//   float u_Transmission;
-//   float u_ShadowStrength;
-// };
-
-// Material Params. Ref:
+// Material Params, as edited on the CPU. The GPU reads the packed
+// GpuMaterial in the MaterialTable instead, see material_table.h for the
+// shader usage.
+// Ref:
 // https://google.github.io/filament/main/materials.html#lit-model
 struct MaterialParams {
   // Diffuse albedo for non-metallic surfaces, and specular color for metallic
@@ -68,15 +57,37 @@ struct MaterialParams {
   BoundedType<float> shadow_strength{0.f, 0.f, 1.f};
 };
 
+// Drops the bounds of `params`.
+inline GpuMaterial PackMaterial(const MaterialParams &params) {
+  GpuMaterial material;
+  material.base_color = params.base_color.Get();
+  material.emissive = params.emissive.Get();
+  material.anisotropy_direction = params.anisotropy_direction.Get();
+  material.roughness = params.roughness.Get();
+  material.normal_factor = params.normal.Get();
+  material.metallic = params.metallic.Get();
+  material.absorption = params.absorption.Get();
+  material.reflectance = params.reflectance.Get();
+  material.ambient_occlusion = params.ambient_occlusion.Get();
+  material.anisotropy = params.anisotropy.Get();
+  material.transmission = params.transmission.Get();
+  material.shadow_strength = params.shadow_strength.Get();
+  return material;
+}
+
+// Shader, textures and params of a surface. The params live in the
+// MaterialTable at GetId().
 class Material {
 public:
   explicit Material(Shader *shader);
   Material(Shader *shader, const MaterialParams &params);
+  ~Material();
 
   void SetParams(const MaterialParams &params) {
     params_ = params;
-    dirty_ = true;
+    MaterialTable::Current().Set(id_, PackMaterial(params_));
   }
+  [[nodiscard]] const MaterialParams &GetParams() const { return params_; }
 
   void SetTexture(TextureMapType type, const Texture *texture) {
     textures_[type] = texture;
@@ -85,14 +96,21 @@ public:
   void Bind(TextureRegistry &reg);
 
   [[nodiscard]] Shader *GetShader() const { return shader_; }
+  // Index of the params in the MaterialTable.
+  [[nodiscard]] uint32_t GetId() const { return id_; }
 
-private:
-  void UploadUBO();
+  // True if binding `other` instead would only change the material index,
+  // i.e. both use the same shader and textures.
+  [[nodiscard]] bool SharesBindings(const Material &other) const {
+    return shader_ == other.shader_ && textures_ == other.textures_;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(Material);
 
+private:
   // TODO(rochan): change to handle
   Shader *shader_;
-  GLuint ubo_ = 0;
-  bool dirty_ = true;
+  uint32_t id_;
 
   MaterialParams params_;
   std::unordered_map<TextureMapType, const Texture *> textures_;
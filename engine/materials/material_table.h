@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "engine/core/gl_core.h"
+#include "engine/core/uniform_ring.h"
+#include "third_party/glad/glad.h"
+#include "third_party/imgui/imgui.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+
+namespace gib {
+
+// Uniform block binding of the material table, keep in sync with GLSL.
+static constexpr GLuint kMaterialTableBinding = 3;
+// Materials in the table. 128 * 96 bytes fits the 16 KiB uniform block size
+// every GL 4.1 implementation supports.
+static constexpr uint32_t kMaxGpuMaterials = 128;
+// Index of the material of a direct draw, set by Material::Bind().
+static constexpr const char *kMaterialIndexUniform = "u_MaterialIndex";
+
+// GPU side material, packed by hand to the std140 layout:
+// struct MaterialData {
+//   vec4 base_color;           // xyz = RGB, w = alpha
+//   vec4 emissive;             // HDR nits, w = exposure weight
+//   vec3 anisotropy_direction;
+//   float roughness;
+//   vec3 normal_factor;        // usually (1,1,1)
+//   float metallic;
+//   vec3 absorption;           // Beer-Lambert
+//   float reflectance;
+//   float ambient_occlusion;
+//   float anisotropy;
+//   float transmission;
+//   float shadow_strength;
+// };
+// layout(std140, binding = 3) uniform MaterialTable {
+//   MaterialData u_Materials[128];
+// };
+// uniform uint u_MaterialIndex; // or u_DrawMaterials[gl_BaseInstance]
+struct alignas(16) GpuMaterial {
+  glm::vec4 base_color{0.f};
+  glm::vec4 emissive{0.f};
+  glm::vec3 anisotropy_direction{0.f};
+  float roughness{0.f};
+  glm::vec3 normal_factor{1.f};
+  float metallic{0.f};
+  glm::vec3 absorption{0.f};
+  float reflectance{0.f};
+  float ambient_occlusion{0.f};
+  float anisotropy{0.f};
+  float transmission{0.f};
+  float shadow_strength{0.f};
+};
+static_assert(offsetof(GpuMaterial, base_color) == 0);
+static_assert(offsetof(GpuMaterial, emissive) == 16);
+static_assert(offsetof(GpuMaterial, anisotropy_direction) == 32);
+static_assert(offsetof(GpuMaterial, roughness) == 44);
+static_assert(offsetof(GpuMaterial, normal_factor) == 48);
+static_assert(offsetof(GpuMaterial, metallic) == 60);
+static_assert(offsetof(GpuMaterial, absorption) == 64);
+static_assert(offsetof(GpuMaterial, reflectance) == 76);
+static_assert(offsetof(GpuMaterial, ambient_occlusion) == 80);
+static_assert(offsetof(GpuMaterial, anisotropy) == 84);
+static_assert(offsetof(GpuMaterial, transmission) == 88);
+static_assert(offsetof(GpuMaterial, shadow_strength) == 92);
+// std140 rounds the array stride of structs up to 16 bytes.
+static_assert(sizeof(GpuMaterial) == 96 && sizeof(GpuMaterial) % 16 == 0,
+              "GpuMaterial must match the std140 MaterialData layout");
+
+// All materials' GpuMaterial entries in one uniform buffer, indexed by
+// material id. Set() only marks an entry dirty; Bind() uploads the dirty
+// entries. Each run of neighbouring dirty entries is written into the
+// UniformRing and copied into the table with glCopyBufferSubData. The copy
+// runs on the GPU in command order, so draws of in-flight frames still read
+// the old entries and the CPU never waits on them.
+//
+// Owned by the WindowBase, created after the UniformRing is initialized.
+// Materials reach it through MaterialTable::Current(). Must only be used from
+// the thread owning the GL context.
+class MaterialTable {
+public:
+  MaterialTable()
+      : materials_(kMaxGpuMaterials), dirty_(kMaxGpuMaterials, false) {
+    ASSERT(current_ == nullptr, "Only one MaterialTable may exist at a time");
+    current_ = this;
+    glGenBuffers(1, &buffer_);
+    GLCore::Current().BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    constexpr auto kBytes =
+        static_cast<GLsizeiptr>(sizeof(GpuMaterial) * kMaxGpuMaterials);
+    glBufferData(GL_UNIFORM_BUFFER, kBytes, materials_.data(),
+                 GL_DYNAMIC_DRAW);
+  }
+  ~MaterialTable() {
+    GLCore::Current().DeleteBuffer(buffer_);
+    current_ = nullptr;
+  }
+
+  static MaterialTable &Current() {
+    ASSERT(current_ != nullptr, "No MaterialTable, create one first");
+    return *current_;
+  }
+
+  // Reserves an entry, reusing freed ids first.
+  [[nodiscard]] uint32_t Allocate() {
+    if (!free_ids_.empty()) {
+      const uint32_t id = free_ids_.back();
+      free_ids_.pop_back();
+      return id;
+    }
+    if (next_id_ >= kMaxGpuMaterials) {
+      THROW_FATAL("More than {} materials", kMaxGpuMaterials);
+    }
+    return next_id_++;
+  }
+
+  void Free(const uint32_t id) { free_ids_.push_back(id); }
+
+  void Set(const uint32_t id, const GpuMaterial &material) {
+    ASSERT(id < next_id_, "Material id {} not allocated", id);
+    materials_[id] = material;
+    dirty_[id] = true;
+    any_dirty_ = true;
+  }
+
+  [[nodiscard]] const GpuMaterial &Get(const uint32_t id) const {
+    return materials_[id];
+  }
+
+  // Uploads the dirty entries and binds the table.
+  void Bind() {
+    Upload();
+    GLCore::Current().BindBufferBase(GL_UNIFORM_BUFFER, kMaterialTableBinding,
+                                     buffer_);
+  }
+
+  [[nodiscard]] uint32_t Size() const {
+    return next_id_ - static_cast<uint32_t>(free_ids_.size());
+  }
+
+  void DebugUI() {
+    if (ImGui::CollapsingHeader("Material Table")) {
+      ImGui::Text("Materials: %u / %u", Size(), kMaxGpuMaterials);
+      ImGui::Text("Uploaded entries: %zu", uploaded_entries_);
+      ImGui::Text("Upload calls: %zu", upload_calls_);
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(MaterialTable);
+
+private:
+  void Upload() {
+    if (!any_dirty_) {
+      return;
+    }
+    GLCore &gl_core = GLCore::Current();
+    UniformRing &ring = UniformRing::Get();
+    gl_core.BindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    uint32_t begin = 0;
+    while (begin < next_id_) {
+      if (!dirty_[begin]) {
+        ++begin;
+        continue;
+      }
+      uint32_t end = begin;
+      while (end < next_id_ && dirty_[end]) {
+        dirty_[end] = false;
+        ++end;
+      }
+      const UniformRange staged = ring.Upload(
+          &materials_[begin], (end - begin) * sizeof(GpuMaterial));
+      gl_core.BindBuffer(GL_COPY_READ_BUFFER, staged.buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                          staged.offset,
+                          static_cast<GLintptr>(begin * sizeof(GpuMaterial)),
+                          staged.size);
+      uploaded_entries_ += end - begin;
+      ++upload_calls_;
+      begin = end;
+    }
+    any_dirty_ = false;
+  }
+
+  static inline MaterialTable *current_ = nullptr;
+
+  GLuint buffer_{0};
+  std::vector<GpuMaterial> materials_;
+  std::vector<bool> dirty_;
+  bool any_dirty_{false};
+  uint32_t next_id_{0};
+  std::vector<uint32_t> free_ids_;
+
+  // Totals since creation.
+  size_t uploaded_entries_{0};
+  size_t upload_calls_{0};
+};
+
+} // namespace gib
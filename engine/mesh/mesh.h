@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
@@ -13,30 +15,104 @@
 
 namespace gib {
 
+// First attribute location of the per-instance attributes. Shader usage:
+// layout(location = 8) in mat4 a_InstanceTransform; // locations 8-11
+// layout(location = 12) in vec4 a_InstanceTint;
+// layout(location = 13) in uint a_InstanceMaterial;
+static constexpr GLuint kInstanceAttributeLocation = 8;
+
+// Per-instance data of Mesh::DrawInstanced().
+struct InstanceData {
+  glm::mat4 transform{1.f};
+  glm::vec4 tint{1.f};
+  // Index into the shader's material table.
+  std::uint32_t material_index{0};
+};
+
+// Vertex layout of InstanceData.
+inline VertexLayout InstanceLayout() {
+  VertexLayout layout;
+  layout.stride = sizeof(InstanceData);
+  layout.divisor = 1;
+  // A mat4 takes one location per column.
+  for (GLuint column = 0; column < 4; ++column) {
+    layout.elements.push_back(
+        {kInstanceAttributeLocation + column, 4, GL_FLOAT, GL_FALSE,
+         offsetof(InstanceData, transform) + column * sizeof(glm::vec4)});
+  }
+  layout.elements.push_back({kInstanceAttributeLocation + 4, 4, GL_FLOAT,
+                             GL_FALSE, offsetof(InstanceData, tint)});
+  layout.elements.push_back({kInstanceAttributeLocation + 5, 1,
+                             GL_UNSIGNED_INT, GL_FALSE,
+                             offsetof(InstanceData, material_index),
+                             /*integer=*/true});
+  return layout;
+}
+
 class Mesh {
 public:
-  Mesh(VertexArray *vao, std::uint32_t index_count, Material *material)
-      : vao_(vao), index_count_(index_count), material_(material) {}
+  // Draws `index_count` indices of `vao` starting at `first_index`, with
+  // `base_vertex` added to each index. Meshes packed into a shared VAO can be
+  // merged into one multi-draw by a RenderQueue.
+  Mesh(VertexArray *vao, std::uint32_t index_count, Material *material,
+       std::uint32_t first_index = 0, std::int32_t base_vertex = 0)
+      : vao_(vao), index_count_(index_count), material_(material),
+        first_index_(first_index), base_vertex_(base_vertex) {}
 
-  // Binds material + VAO, then emits glDraw
+  // Binds material + VAO, then emits glDraw. Prefer submitting to a
+  // RenderQueue, which orders draws to minimize state changes.
   void Draw(TextureRegistry &texture_registry) const {
     material_->Bind(texture_registry); // UBO + textures + shader
-    vao_->Bind();                      // vertex + index buffers
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(index_count_),
-                   GL_UNSIGNED_INT, nullptr);
+    DrawGeometry();
+  }
+
+  // Draws one copy of the mesh per element of `instances` with a single
+  // glDrawElementsInstanced, e.g. for crowds of projectiles or debris.
+  void DrawInstanced(TextureRegistry &texture_registry,
+                     const std::vector<InstanceData> &instances) const {
+    if (instances.empty()) {
+      return;
+    }
+    material_->Bind(texture_registry);
+    if (!vao_->HasInstanceLayout()) {
+      vao_->SetInstanceLayout(InstanceLayout());
+    }
+    vao_->SetInstanceData(instances.data(),
+                          instances.size() * sizeof(InstanceData));
+    vao_->Bind();
+    glDrawElementsInstancedBaseVertex(
+        GL_TRIANGLES, static_cast<GLsizei>(index_count_), GL_UNSIGNED_INT,
+        IndexOffset(), static_cast<GLsizei>(instances.size()), base_vertex_);
+  }
+
+  // Binds the VAO and emits glDraw with whatever material is bound.
+  void DrawGeometry() const {
+    vao_->Bind(); // vertex + index buffers
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(index_count_),
+                             GL_UNSIGNED_INT, IndexOffset(), base_vertex_);
   }
 
   // TODO(rochan): Use handles
   [[nodiscard]] const VertexArray *GetVao() const { return vao_; }
-  Material *GetMaterial() { return material_; }
+  [[nodiscard]] Material *GetMaterial() const { return material_; }
   [[nodiscard]] std::uint32_t IndexCount() const { return index_count_; }
+  [[nodiscard]] std::uint32_t FirstIndex() const { return first_index_; }
+  [[nodiscard]] std::int32_t BaseVertex() const { return base_vertex_; }
 
   DISALLOW_COPY_AND_ASSIGN(Mesh);
 
 private:
+  // Byte offset of the first index in the element buffer.
+  [[nodiscard]] const void *IndexOffset() const {
+    return reinterpret_cast<const void *>(
+        static_cast<std::uintptr_t>(first_index_) * sizeof(std::uint32_t));
+  }
+
   VertexArray *vao_;
   std::uint32_t index_count_ = 0;
   Material *material_ = {};
+  std::uint32_t first_index_ = 0;
+  std::int32_t base_vertex_ = 0;
 };
 
 } // namespace gib
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "engine/materials/material.h"
+#include "engine/mesh/mesh.h"
+#include "engine/vertex_util/vertex_array.h"
+#include "engine/vertex_util/vertex_layout.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+
+namespace gib {
+
+// Vertex read by the multi-draw-indirect shaders, see
+// engine/renderer/shaders/draw_indirect.vert.
+struct PoolVertex {
+  glm::vec3 position{0.f};
+  glm::vec3 normal{0.f};
+  glm::vec2 tex_coord{0.f};
+};
+
+// Vertex layout of PoolVertex.
+inline VertexLayout PoolVertexLayout() {
+  VertexLayout layout;
+  layout.stride = sizeof(PoolVertex);
+  layout.elements.push_back(
+      {0, 3, GL_FLOAT, GL_FALSE, offsetof(PoolVertex, position)});
+  layout.elements.push_back(
+      {1, 3, GL_FLOAT, GL_FALSE, offsetof(PoolVertex, normal)});
+  layout.elements.push_back(
+      {2, 2, GL_FLOAT, GL_FALSE, offsetof(PoolVertex, tex_coord)});
+  return layout;
+}
+
+// Packs the vertices and indices of many meshes into one VertexArray. Meshes
+// created from the pool share a VAO, so a RenderQueue merges their draws into
+// one glMultiDrawElementsIndirect when their materials share bindings.
+//
+// Usage: Add() the geometry of every mesh, Upload(), then CreateMesh() for
+// each returned range. Adding after Upload() needs another Upload(); the
+// ranges of earlier meshes stay valid.
+class MeshPool {
+public:
+  // Indices of one added mesh in the pool's buffers.
+  struct Range {
+    std::uint32_t index_count{0};
+    std::uint32_t first_index{0};
+    std::int32_t base_vertex{0};
+  };
+
+  explicit MeshPool(VertexLayout layout = PoolVertexLayout())
+      : layout_(std::move(layout)) {}
+
+  // Appends a mesh. `indices` are relative to its first vertex.
+  template <typename Vertex>
+  Range Add(const std::vector<Vertex> &vertices,
+            const std::vector<std::uint32_t> &indices) {
+    ASSERT(sizeof(Vertex) == layout_.stride,
+           "Vertex size {} does not match the pool stride {}", sizeof(Vertex),
+           layout_.stride);
+    ASSERT(!vertices.empty() && !indices.empty(), "Mesh has no geometry");
+    const Range range{static_cast<std::uint32_t>(indices.size()),
+                      static_cast<std::uint32_t>(indices_.size()),
+                      static_cast<std::int32_t>(vertex_count_)};
+    const auto *bytes = reinterpret_cast<const std::byte *>(vertices.data());
+    vertices_.insert(vertices_.end(), bytes,
+                     bytes + vertices.size() * sizeof(Vertex));
+    indices_.insert(indices_.end(), indices.begin(), indices.end());
+    vertex_count_ += vertices.size();
+    return range;
+  }
+
+  // (Re)uploads all added geometry to the shared VAO.
+  void Upload(const GLenum usage = GL_STATIC_DRAW) {
+    ASSERT(!indices_.empty(), "Nothing added to the pool");
+    vao_.SetVertexData(vertices_.data(), vertices_.size(), usage);
+    vao_.SetElementData(indices_.data(),
+                        indices_.size() * sizeof(std::uint32_t), usage);
+    if (!has_layout_) {
+      vao_.SetLayout(layout_);
+      has_layout_ = true;
+    }
+  }
+
+  // Mesh drawing `range` of the pool with `material`.
+  [[nodiscard]] std::unique_ptr<Mesh> CreateMesh(const Range &range,
+                                                 Material *material) {
+    return std::make_unique<Mesh>(&vao_, range.index_count, material,
+                                  range.first_index, range.base_vertex);
+  }
+
+  [[nodiscard]] const VertexArray &GetVao() const { return vao_; }
+  [[nodiscard]] std::size_t VertexCount() const { return vertex_count_; }
+  [[nodiscard]] std::size_t IndexCount() const { return indices_.size(); }
+
+  DISALLOW_COPY_AND_ASSIGN(MeshPool);
+
+private:
+  VertexLayout layout_;
+  VertexArray vao_;
+  bool has_layout_{false};
+
+  // CPU copies, kept so Upload() can resend everything after an Add().
+  std::vector<std::byte> vertices_;
+  std::vector<std::uint32_t> indices_;
+  std::size_t vertex_count_{0};
+};
+
+} // namespace gib
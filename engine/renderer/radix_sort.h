@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace gib {
+
+// Sort key and the index of the item it belongs to.
+struct SortEntry {
+  uint64_t key;
+  uint32_t index;
+};
+
+// Sorts `entries` by key, stable, using an LSD radix sort with 8-bit digits.
+// Digits that are equal for all keys are skipped, so keys with unused high
+// bits cost fewer passes. `scratch` is resized as needed and can be reused
+// across calls to avoid allocations.
+inline void RadixSortByKey(std::vector<SortEntry> &entries,
+                           std::vector<SortEntry> &scratch) {
+  constexpr int kDigitBits = 8;
+  constexpr size_t kBuckets = size_t{1} << kDigitBits;
+  constexpr int kPasses = 64 / kDigitBits;
+
+  const size_t count = entries.size();
+  if (count < 2) {
+    return;
+  }
+  scratch.resize(count);
+
+  // Histogram all digits in one read of the keys.
+  std::array<std::array<uint32_t, kBuckets>, kPasses> histograms{};
+  for (const SortEntry &entry : entries) {
+    for (int pass = 0; pass < kPasses; ++pass) {
+      ++histograms[pass][(entry.key >> (pass * kDigitBits)) & (kBuckets - 1)];
+    }
+  }
+
+  std::vector<SortEntry> *src = &entries;
+  std::vector<SortEntry> *dst = &scratch;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    std::array<uint32_t, kBuckets> &histogram = histograms[pass];
+    const uint64_t first_digit =
+        (entries.front().key >> (pass * kDigitBits)) & (kBuckets - 1);
+    if (histogram[first_digit] == count) {
+      continue; // every key has the same digit
+    }
+    uint32_t offset = 0;
+    for (uint32_t &bucket : histogram) {
+      const uint32_t bucket_count = bucket;
+      bucket = offset;
+      offset += bucket_count;
+    }
+    for (const SortEntry &entry : *src) {
+      const size_t digit =
+          (entry.key >> (pass * kDigitBits)) & (kBuckets - 1);
+      (*dst)[histogram[digit]++] = entry;
+    }
+    std::swap(src, dst);
+  }
+  if (src != &entries) {
+    entries.swap(scratch);
+  }
+}
+
+} // namespace gib
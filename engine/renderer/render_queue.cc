@@ -0,0 +1,250 @@
+#include "engine/renderer/render_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "third_party/imgui/imgui.h"
+
+namespace gib {
+namespace {
+
+constexpr UniformHandle kModelMatrix(kModelMatrixUniform);
+
+// Sort key layout, most significant first.
+constexpr int kPassBits = 4;
+constexpr int kShaderBits = 10;
+constexpr int kMaterialBits = 14;
+constexpr int kVaoBits = 12;
+constexpr int kDepthBits = 24;
+static_assert(kPassBits + kShaderBits + kMaterialBits + kVaoBits +
+                      kDepthBits ==
+                  64,
+              "Sort key must use all 64 bits");
+
+constexpr uint64_t Mask(const int bits) { return (uint64_t{1} << bits) - 1; }
+
+// Top kDepthBits of the float's bits. For non-negative floats the bit
+// pattern increases with the value, so this orders depths without needing a
+// near/far range.
+uint64_t QuantizeDepth(const float depth) {
+  const float clamped = depth > 0.f ? depth : 0.f;
+  uint32_t bits = 0;
+  std::memcpy(&bits, &clamped, sizeof(bits));
+  return bits >> (32 - kDepthBits);
+}
+
+// Orphans `buffer`, creating it if needed, and fills it with `data`.
+template <typename T>
+void UploadStreamBuffer(GLuint &buffer, const std::vector<T> &data,
+                        const GLenum target) {
+  if (buffer == 0) {
+    glGenBuffers(1, &buffer);
+  }
+  GLCore::Current().BindBuffer(target, buffer);
+  glBufferData(target, static_cast<GLsizeiptr>(data.size() * sizeof(T)),
+               data.data(), GL_STREAM_DRAW);
+}
+
+} // namespace
+
+RenderQueue::~RenderQueue() {
+  for (const GLuint buffer :
+       {command_buffer_, transform_buffer_, material_buffer_}) {
+    if (buffer != 0) {
+      GLCore::Current().DeleteBuffer(buffer);
+    }
+  }
+}
+
+void RenderQueue::Submit(const Mesh &mesh, const glm::mat4 &transform,
+                         const RenderPass pass, Material *material) {
+  const DrawItem item{
+      &mesh, material != nullptr ? material : mesh.GetMaterial(), transform,
+      pass};
+  if (!item.material->GetShader()->IsReady()) {
+    // Still building in the background, see ShaderBuildQueue.
+    ++not_ready_;
+    return;
+  }
+  // View space depth, the camera looks down -z.
+  const float depth = -(view_ * transform[3]).z;
+  entries_.push_back(
+      {SortKey(item, depth), static_cast<uint32_t>(items_.size())});
+  items_.push_back(item);
+}
+
+void RenderQueue::Execute(TextureRegistry &texture_registry) {
+  PROFILE_SCOPE_N("RenderQueue::Execute");
+  RadixSortByKey(entries_, scratch_);
+
+  stats_ = {};
+  stats_.not_ready = not_ready_;
+  bound_shader_ = nullptr;
+  bound_material_ = nullptr;
+  bound_vao_ = nullptr;
+  if (UsesMultiDrawIndirect()) {
+    ExecuteIndirect(texture_registry);
+  } else {
+    ExecuteDirect(texture_registry);
+  }
+  UnbindState(texture_registry);
+}
+
+void RenderQueue::ExecuteDirect(TextureRegistry &texture_registry) {
+  for (const SortEntry &entry : entries_) {
+    const DrawItem &item = items_[entry.index];
+    BindState(item.material, item.mesh->GetVao(), texture_registry);
+    bound_shader_->SetMat4(kModelMatrix, item.transform);
+    item.mesh->DrawGeometry();
+    ++stats_.draws;
+  }
+}
+
+void RenderQueue::ExecuteIndirect(TextureRegistry &texture_registry) {
+  if (entries_.empty()) {
+    return;
+  }
+  // One command per item in sorted order. base_instance is the item's index
+  // into the per-draw SSBOs. The command buffer stays bound to
+  // GL_DRAW_INDIRECT_BUFFER after the upload.
+  commands_.clear();
+  draw_transforms_.clear();
+  draw_materials_.clear();
+  for (const SortEntry &entry : entries_) {
+    const DrawItem &item = items_[entry.index];
+    commands_.push_back({item.mesh->IndexCount(), 1, item.mesh->FirstIndex(),
+                         item.mesh->BaseVertex(),
+                         static_cast<GLuint>(commands_.size())});
+    draw_transforms_.push_back(item.transform);
+    draw_materials_.push_back(item.material->GetId());
+  }
+  GLCore &gl_core = GLCore::Current();
+  UploadStreamBuffer(command_buffer_, commands_, GL_DRAW_INDIRECT_BUFFER);
+  UploadStreamBuffer(transform_buffer_, draw_transforms_,
+                     GL_COPY_WRITE_BUFFER);
+  UploadStreamBuffer(material_buffer_, draw_materials_, GL_COPY_WRITE_BUFFER);
+  gl_core.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawTransformsBinding,
+                         transform_buffer_);
+  gl_core.BindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawMaterialsBinding,
+                         material_buffer_);
+
+  // Draws read their material from the table by index, so materials only
+  // split a batch if their shader or textures differ.
+  const auto same_batch = [](const DrawItem &a, const DrawItem &b) {
+    return a.pass == b.pass && a.material->SharesBindings(*b.material) &&
+           a.mesh->GetVao() == b.mesh->GetVao();
+  };
+  size_t begin = 0;
+  while (begin < entries_.size()) {
+    const DrawItem &first = items_[entries_[begin].index];
+    size_t end = begin + 1;
+    while (end < entries_.size() &&
+           same_batch(first, items_[entries_[end].index])) {
+      ++end;
+    }
+    BindState(first.material, first.mesh->GetVao(), texture_registry);
+    first.mesh->GetVao()->Bind();
+    GLExtensions::Get().MultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_INT,
+        reinterpret_cast<const void *>(begin *
+                                       sizeof(DrawElementsIndirectCommand)),
+        static_cast<GLsizei>(end - begin), /*stride=*/0);
+    ++stats_.indirect_calls;
+    stats_.draws += end - begin;
+    begin = end;
+  }
+}
+
+void RenderQueue::BindState(Material *material, const VertexArray *vao,
+                            TextureRegistry &texture_registry) {
+  if (material != bound_material_) {
+    UnbindState(texture_registry);
+    bound_material_ = material;
+    texture_registry.PushUsageBlock();
+    // Binds the program, material UBO and textures. GLCore drops the ones
+    // already bound.
+    material->Bind(texture_registry);
+    ++stats_.material_changes;
+    if (material->GetShader() != bound_shader_) {
+      bound_shader_ = material->GetShader();
+      ++stats_.program_changes;
+    }
+  }
+  if (vao != bound_vao_) {
+    bound_vao_ = vao;
+    ++stats_.vao_changes;
+  }
+}
+
+void RenderQueue::UnbindState(TextureRegistry &texture_registry) {
+  if (bound_material_ != nullptr) {
+    texture_registry.PopUsageBlock();
+    bound_material_ = nullptr;
+  }
+}
+
+void RenderQueue::Clear() {
+  items_.clear();
+  entries_.clear();
+  shader_ids_.clear();
+  material_ids_.clear();
+  vao_ids_.clear();
+  not_ready_ = 0;
+}
+
+void RenderQueue::DebugUI() {
+  if (ImGui::CollapsingHeader("Render Queue")) {
+    bool multi_draw_indirect = multi_draw_indirect_;
+    if (ImGui::Checkbox("Multi-draw-indirect", &multi_draw_indirect)) {
+      ToggleMultiDrawIndirect(multi_draw_indirect);
+    }
+    if (multi_draw_indirect_ &&
+        !GLExtensions::Get().SupportsMultiDrawIndirect()) {
+      ImGui::Text("Not supported by this context, drawing directly");
+    }
+    ImGui::Text("Draws: %zu", stats_.draws);
+    ImGui::Text("Skipped, shader not ready: %zu", stats_.not_ready);
+    ImGui::Text("Indirect calls: %zu", stats_.indirect_calls);
+    ImGui::Text("Program changes: %zu", stats_.program_changes);
+    ImGui::Text("Material changes: %zu", stats_.material_changes);
+    ImGui::Text("VAO changes: %zu", stats_.vao_changes);
+  }
+}
+
+uint64_t RenderQueue::DenseId(std::unordered_map<const void *, uint64_t> &ids,
+                              const void *key, const int bits) {
+  const auto [it, inserted] = ids.try_emplace(key, ids.size());
+  if (inserted && it->second > Mask(bits)) {
+    WARNING("More than {} distinct sort key ids, draws may not be grouped",
+            Mask(bits) + 1);
+  }
+  return std::min(it->second, Mask(bits));
+}
+
+uint64_t RenderQueue::SortKey(const DrawItem &item, const float depth) {
+  const uint64_t pass = static_cast<uint64_t>(item.pass) & Mask(kPassBits);
+  const uint64_t shader =
+      DenseId(shader_ids_, item.material->GetShader(), kShaderBits);
+  const uint64_t material =
+      DenseId(material_ids_, item.material, kMaterialBits);
+  const uint64_t vao = DenseId(vao_ids_, item.mesh->GetVao(), kVaoBits);
+  const uint64_t quantized_depth = QuantizeDepth(depth);
+
+  uint64_t key = pass << (64 - kPassBits);
+  if (item.pass == RenderPass::TRANSPARENT) {
+    // Back to front: farther items get smaller keys.
+    key |= (Mask(kDepthBits) - quantized_depth)
+           << (kShaderBits + kMaterialBits + kVaoBits);
+    key |= shader << (kMaterialBits + kVaoBits);
+    key |= material << kVaoBits;
+    key |= vao;
+  } else {
+    key |= shader << (kMaterialBits + kVaoBits + kDepthBits);
+    key |= material << (kVaoBits + kDepthBits);
+    key |= vao << kDepthBits;
+    key |= quantized_depth;
+  }
+  return key;
+}
+
+} // namespace gib
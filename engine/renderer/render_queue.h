@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "engine/core/gl_ext.h"
+#include "engine/materials/material.h"
+#include "engine/mesh/mesh.h"
+#include "engine/renderer/radix_sort.h"
+#include "engine/textures/texture.h"
+#include "util/macros.h"
+
+namespace gib {
+
+// Name of the model matrix uniform set for every draw.
+static constexpr const char *kModelMatrixUniform = "u_Model";
+
+// SSBO binding points of the per-draw data of the multi-draw-indirect path,
+// declared in shaders/draw_data.glsl:
+// mat4 model = u_DrawTransforms[gl_BaseInstance];
+// uint material = u_DrawMaterials[gl_BaseInstance];
+static constexpr GLuint kDrawTransformsBinding = 0;
+static constexpr GLuint kDrawMaterialsBinding = 1;
+
+// Render passes, in execution order.
+enum class RenderPass : unsigned char {
+  SHADOW = 0,
+  OPAQUE = 1,
+  SKYBOX = 2,
+  // Sorted back to front.
+  TRANSPARENT = 3,
+  OVERLAY = 4,
+};
+
+// One submitted draw.
+struct DrawItem {
+  const Mesh *mesh;
+  Material *material;
+  glm::mat4 transform;
+  RenderPass pass;
+};
+
+// Collects the draws of a frame and executes them in an order that minimizes
+// GL state changes.
+//
+// Every item gets a 64-bit sort key:
+//   opaque:      pass | shader | material | VAO | depth (front to back)
+//   transparent: pass | depth (back to front) | shader | material | VAO
+// so opaque draws are grouped by state and drawn front to back within a
+// group for early-z, while transparent draws keep a correct blending order.
+// Shaders, materials and VAOs get dense per-frame ids in order of first
+// submission. Keys are radix sorted.
+//
+// If the context supports it and multi-draw-indirect is enabled, consecutive
+// sorted draws that share pass, VAO, shader and textures are merged into one
+// glMultiDrawElementsIndirect. Only copies of a mesh, or meshes created from
+// one MeshPool, share a VAO; meshes owning their VAO still cost a call each.
+// Transforms and MaterialTable indices are then read from SSBOs instead of
+// uniforms, indexed by gl_BaseInstance. The draw_indirect_shaders do so, and
+// expect the PoolVertex layout and a u_ViewProjection uniform.
+//
+// Usage per frame: SetViewMatrix(), Submit() every draw, Execute(), Clear().
+class RenderQueue {
+public:
+  RenderQueue() = default;
+  ~RenderQueue();
+
+  // View matrix used to compute the depth of submitted items.
+  void SetViewMatrix(const glm::mat4 &view) { view_ = view; }
+
+  // Queues `mesh` with its own material, or `material` if given. Skipped if
+  // the material's shader is not built yet.
+  void Submit(const Mesh &mesh, const glm::mat4 &transform,
+              RenderPass pass = RenderPass::OPAQUE,
+              Material *material = nullptr);
+
+  // Sorts and draws all queued items.
+  void Execute(TextureRegistry &texture_registry);
+
+  // Removes all queued items. Call once the frame is drawn.
+  void Clear();
+
+  [[nodiscard]] size_t Size() const { return items_.size(); }
+
+  // Opts into the multi-draw-indirect path. Shaders must then read the
+  // per-draw SSBOs, e.g. the draw_indirect_shaders. Ignored if the context
+  // does not support it.
+  void ToggleMultiDrawIndirect(bool enable) { multi_draw_indirect_ = enable; }
+  // True if Execute() uses the multi-draw-indirect path.
+  [[nodiscard]] bool UsesMultiDrawIndirect() const {
+    return multi_draw_indirect_ &&
+           GLExtensions::Get().SupportsMultiDrawIndirect();
+  }
+
+  void DebugUI();
+
+  DISALLOW_COPY_AND_ASSIGN(RenderQueue);
+
+private:
+  // State changes made by the last Execute().
+  struct ExecuteStats {
+    size_t draws{0};
+    size_t indirect_calls{0};
+    size_t program_changes{0};
+    size_t material_changes{0};
+    size_t vao_changes{0};
+    // Submitted items skipped because their shader was not built yet.
+    size_t not_ready{0};
+  };
+
+  // One draw per item, setting u_Model in between.
+  void ExecuteDirect(TextureRegistry &texture_registry);
+  // One glMultiDrawElementsIndirect per run of items sharing pass, VAO,
+  // shader and textures.
+  void ExecuteIndirect(TextureRegistry &texture_registry);
+
+  // Binds `material` and `vao` unless already bound, counting the changes.
+  void BindState(Material *material, const VertexArray *vao,
+                 TextureRegistry &texture_registry);
+  // Releases the texture units of the last bound material.
+  void UnbindState(TextureRegistry &texture_registry);
+
+  // Dense id of `key`, assigned in order of first use and clamped to `bits`.
+  static uint64_t DenseId(std::unordered_map<const void *, uint64_t> &ids,
+                          const void *key, int bits);
+
+  [[nodiscard]] uint64_t SortKey(const DrawItem &item, float depth);
+
+  glm::mat4 view_{1.f};
+
+  std::vector<DrawItem> items_;
+  std::vector<SortEntry> entries_;
+  std::vector<SortEntry> scratch_;
+  size_t not_ready_{0};
+
+  std::unordered_map<const void *, uint64_t> shader_ids_;
+  std::unordered_map<const void *, uint64_t> material_ids_;
+  std::unordered_map<const void *, uint64_t> vao_ids_;
+
+  // State bound by the running Execute().
+  const Shader *bound_shader_{nullptr};
+  Material *bound_material_{nullptr};
+  const VertexArray *bound_vao_{nullptr};
+
+  // Multi-draw-indirect path, buffers are orphaned every frame.
+  bool multi_draw_indirect_{false};
+  std::vector<DrawElementsIndirectCommand> commands_;
+  std::vector<glm::mat4> draw_transforms_;
+  std::vector<uint32_t> draw_materials_;
+  GLuint command_buffer_{0};
+  GLuint transform_buffer_{0};
+  GLuint material_buffer_{0};
+
+  ExecuteStats stats_;
+};
+
+} // namespace gib
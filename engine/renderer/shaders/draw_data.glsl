@@ -0,0 +1,29 @@
+// Per-draw data of RenderQueue's multi-draw-indirect path, indexed by
+// gl_BaseInstance. Keep in sync with render_queue.h and material_table.h.
+
+layout(std430, binding = 0) readonly buffer DrawTransforms {
+	mat4 u_DrawTransforms[];
+};
+
+layout(std430, binding = 1) readonly buffer DrawMaterials {
+	uint u_DrawMaterials[];
+};
+
+struct MaterialData {
+	vec4 base_color;
+	vec4 emissive;
+	vec3 anisotropy_direction;
+	float roughness;
+	vec3 normal_factor;
+	float metallic;
+	vec3 absorption;
+	float reflectance;
+	float ambient_occlusion;
+	float anisotropy;
+	float transmission;
+	float shadow_strength;
+};
+
+layout(std140, binding = 3) uniform MaterialTable {
+	MaterialData u_Materials[128];
+};
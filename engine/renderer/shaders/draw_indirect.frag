@@ -0,0 +1,20 @@
+#version 460 core
+#include "draw_data.glsl"
+
+in vec3 v_Normal;
+in vec2 v_TexCoord;
+flat in uint v_MaterialIndex;
+
+out vec4 FragColor;
+
+uniform sampler2D u_Diffuse;
+uniform vec3 u_LightDirection;
+
+void main()
+{
+	MaterialData material = u_Materials[v_MaterialIndex];
+	vec4 albedo = material.base_color * texture(u_Diffuse, v_TexCoord);
+	float diffuse = max(dot(normalize(v_Normal), -u_LightDirection), 0.0);
+	FragColor = vec4(albedo.rgb * (0.1 + 0.9 * diffuse) + material.emissive.rgb,
+	                 albedo.a);
+}
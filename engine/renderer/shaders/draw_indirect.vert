@@ -0,0 +1,21 @@
+#version 460 core
+#include "draw_data.glsl"
+
+layout (location = 0) in vec3 a_Position;
+layout (location = 1) in vec3 a_Normal;
+layout (location = 2) in vec2 a_TexCoord;
+
+uniform mat4 u_ViewProjection;
+
+out vec3 v_Normal;
+out vec2 v_TexCoord;
+flat out uint v_MaterialIndex;
+
+void main()
+{
+	mat4 model = u_DrawTransforms[gl_BaseInstance];
+	gl_Position = u_ViewProjection * model * vec4(a_Position, 1.0);
+	v_Normal = mat3(transpose(inverse(model))) * a_Normal;
+	v_TexCoord = a_TexCoord;
+	v_MaterialIndex = u_DrawMaterials[gl_BaseInstance];
+}
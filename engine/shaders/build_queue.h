@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "engine/core/gl_ext.h"
+#include "engine/shaders/shader.h"
+#include "third_party/imgui/imgui.h"
+#include "util/macros.h"
+#include "util/report/report.h"
+#include "util/time/time.h"
+
+namespace gib {
+
+// Shaders building in the background. Submit all of a level's shaders up
+// front with Add(), then Poll() once per frame; draws skip shaders that are
+// not IsReady() yet.
+//
+// With GL_KHR_parallel_shader_compile the driver compiles on its own threads
+// and Poll() only finishes completed builds. Without it, completion cannot be
+// queried without blocking, so Poll() finishes builds in submission order
+// until `budget` is spent, at least one per call, spreading the stall over
+// frames instead of taking it all at load.
+//
+// Shaders must outlive their build. Must only be used from the thread owning
+// the GL context.
+class ShaderBuildQueue {
+public:
+  ShaderBuildQueue() = default;
+  ~ShaderBuildQueue() {
+    if (!pending_.empty()) {
+      WARNING("{} shaders still building, waiting", pending_.size());
+      Wait();
+    }
+  }
+
+  // Starts building `shader`.
+  void Add(Shader *shader) {
+    shader->LinkAsync();
+    pending_.push_back(shader);
+    ++submitted_;
+  }
+
+  // Finishes the builds that completed, see the class comment.
+  void Poll(const time_util::DurationUsec budget =
+                time_util::DurationUsec(2000)) {
+    if (pending_.empty()) {
+      return;
+    }
+    PROFILE_SCOPE_N("ShaderBuildQueue::Poll");
+    const auto ready = std::remove_if(
+        pending_.begin(), pending_.end(),
+        [](Shader *shader) { return shader->PollLink(); });
+    pending_.erase(ready, pending_.end());
+
+    if (GLExtensions::Get().SupportsParallelShaderCompile()) {
+      return;
+    }
+    const time_util::TimePoint start = time_util::now();
+    size_t finished = 0;
+    while (finished < pending_.size() &&
+           (finished == 0 || time_util::elapsed_usec(start) < budget)) {
+      pending_[finished++]->FinishLink();
+    }
+    pending_.erase(pending_.begin(),
+                   pending_.begin() + static_cast<std::ptrdiff_t>(finished));
+  }
+
+  // Blocks until all builds complete, e.g. behind a loading screen.
+  void Wait() {
+    for (Shader *shader : pending_) {
+      shader->FinishLink();
+    }
+    pending_.clear();
+  }
+
+  // Shaders not ready yet.
+  [[nodiscard]] size_t Pending() const { return pending_.size(); }
+  [[nodiscard]] bool Empty() const { return pending_.empty(); }
+
+  void DebugUI() const {
+    if (ImGui::CollapsingHeader("Shader Builds")) {
+      ImGui::Text("Built: %zu / %zu", submitted_ - pending_.size(),
+                  submitted_);
+      ImGui::Text("Parallel compile: %s",
+                  GLExtensions::Get().SupportsParallelShaderCompile() ? "yes"
+                                                                      : "no");
+    }
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(ShaderBuildQueue);
+
+private:
+  // In submission order.
+  std::vector<Shader *> pending_;
+  // Total since creation.
+  size_t submitted_{0};
+};
+
+} // namespace gib
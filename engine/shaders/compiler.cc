@@ -1,59 +1,194 @@
 #include "engine/shaders/compiler.h"
+
+#include <algorithm>
+
+#include "engine/core/gl_ext.h"
+#include "engine/shaders/program_cache.h"
 #include "engine/shaders/types.h"
+#include "util/time/time.h"
 
 namespace gib {
 
-unsigned int ShaderCompiler::LoadAndCompile(const ShaderSource &source) {
-  std::stringstream shader_stream;
-  if (source.is_path) {
-    try {
-      std::ifstream shader_file;
-      shader_file.open(source.shader);
-      shader_stream << shader_file.rdbuf();
-      shader_file.close();
-    } catch (const std::ifstream::failure &exc) {
-      THROW_FATAL("No support for ShaderSource from path!\n{}",
-                  std::string(source.shader));
+void ShaderCompiler::Load(const ShaderSource &source,
+                          const std::string &defines) {
+  Origin origin{source.shader, source.type, source.is_path, defines};
+  PreprocessedShader preprocessed = Preprocess(origin);
+  if (!preprocessed.error.empty()) {
+    THROW_FATAL("Failed to load shader: {}", preprocessed.error);
+  }
+  files_.insert(files_.end(), preprocessed.files.begin(),
+                preprocessed.files.end());
+  origins_.push_back(std::move(origin));
+  LoadPreprocessed(std::move(preprocessed.text), source.type);
+}
+
+void ShaderCompiler::LoadPreprocessed(std::string text,
+                                      const ShaderType type) {
+  sources_.push_back({std::move(text), type});
+}
+
+PreprocessedShader ShaderCompiler::Preprocess(const Origin &origin) {
+  PreprocessedShader preprocessed =
+      origin.is_path ? PreprocessShaderFile(origin.shader)
+                     : PreprocessShaderText(origin.shader, "");
+  if (preprocessed.error.empty()) {
+    preprocessed.text =
+        InjectDefines(std::move(preprocessed.text), origin.defines);
+  }
+  return preprocessed;
+}
+
+std::string ShaderCompiler::InjectDefines(std::string text,
+                                          const std::string &defines) {
+  if (defines.empty()) {
+    return text;
+  }
+  size_t insert_at = 0;
+  const size_t version = text.find("#version");
+  if (version != std::string::npos) {
+    const size_t line_end = text.find('\n', version);
+    if (line_end == std::string::npos) {
+      text.push_back('\n');
+      insert_at = text.size();
+    } else {
+      insert_at = line_end + 1;
     }
   }
-  ShaderSource const loaded_shader{source.is_path ? shader_stream.str().c_str()
-                                                  : source.shader,
-                                   source.type, false};
-  unsigned int const shader = Compile(loaded_shader, source.type);
-  shaders_.push_back(shader);
-  return shader;
+  // Lines after the defines keep their numbers in compile errors.
+  const auto lines = std::count(text.data(), text.data() + insert_at, '\n');
+  text.insert(insert_at, fmt::format("{}#line {} 0\n", defines, lines + 1));
+  return text;
 }
 
-unsigned int ShaderCompiler::Link() {
-  int success = false;
-  unsigned int const shader_program = glCreateProgram();
-  for (const auto &shader : shaders_) {
-    glAttachShader(shader_program, shader);
+void ShaderCompiler::Submit() {
+  ASSERT(!IsPending(), "A program is already being built");
+  submit_time_ = time_util::now();
+  ProgramBinaryCache *cache = ProgramBinaryCache::Current();
+  use_cache_ = cache != nullptr && cache->IsEnabled();
+  source_hash_ = use_cache_ ? SourceHash() : 0;
+  if (use_cache_) {
+    program_ = cache->Load(source_hash_);
+    if (program_ != 0) {
+      sources_.clear();
+      return;
+    }
   }
-  glLinkProgram(shader_program);
 
-  glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-  CHECK_GL_PROGRAM_ERROR(success, glGetProgramInfoLog, shader_program);
+  shaders_.reserve(sources_.size());
+  for (const LoadedSource &source : sources_) {
+    shaders_.push_back(Compile(source));
+  }
+  program_ = glCreateProgram();
+  for (const GLuint shader : shaders_) {
+    glAttachShader(program_, shader);
+  }
+  if (use_cache_) {
+    glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  glLinkProgram(program_);
+  sources_.clear();
+}
+
+bool ShaderCompiler::Poll() const {
+  ASSERT(IsPending(), "No program is being built");
+  if (shaders_.empty()) {
+    // Loaded from the cache.
+    return true;
+  }
+  if (!GLExtensions::Get().SupportsParallelShaderCompile()) {
+    return false;
+  }
+  GLint complete = GL_FALSE;
+  glGetProgramiv(program_, GL_COMPLETION_STATUS_KHR, &complete);
+  return complete == GL_TRUE;
+}
 
-  for (const auto &shader : shaders_) {
+unsigned int ShaderCompiler::Finish() {
+  bool linked = false;
+  return FinishBuild(linked);
+}
+
+unsigned int ShaderCompiler::TryFinish() {
+  bool linked = false;
+  const GLuint program = FinishBuild(linked);
+  if (!linked) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+unsigned int ShaderCompiler::FinishBuild(bool &linked) {
+  ASSERT(IsPending(), "No program is being built");
+  const GLuint program = program_;
+  program_ = 0;
+  // The cache may have been destroyed since Submit().
+  ProgramBinaryCache *cache =
+      use_cache_ ? ProgramBinaryCache::Current() : nullptr;
+  if (shaders_.empty()) {
+    linked = true;
+    if (cache != nullptr) {
+      cache->RecordBuild(/*from_binary=*/true,
+                         time_util::elapsed_usec(submit_time_));
+    }
+    return program;
+  }
+
+  GLint success = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (success == GL_FALSE) {
+    // Report the compile errors, which are the likely cause.
+    for (const GLuint shader : shaders_) {
+      GLint compiled = GL_FALSE;
+      glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+      CHECK_GL_PROGRAM_ERROR(compiled, glGetShaderInfoLog, shader);
+    }
+  }
+  CHECK_GL_PROGRAM_ERROR(success, glGetProgramInfoLog, program);
+  linked = success == GL_TRUE;
+
+  for (const GLuint shader : shaders_) {
     glDeleteShader(shader);
   }
   shaders_.clear();
-  return shader_program;
+  if (cache != nullptr && linked) {
+    cache->Store(source_hash_, program);
+    cache->RecordBuild(/*from_binary=*/false,
+                       time_util::elapsed_usec(submit_time_));
+  }
+  return program;
 }
 
-unsigned int ShaderCompiler::Compile(const ShaderSource &source,
-                                     const ShaderType type) {
-  unsigned int const shader = glCreateShader(static_cast<GLenum>(type));
-
-  glShaderSource(shader, 1, &source.shader, nullptr);
-  glCompileShader(shader);
+unsigned int ShaderCompiler::Link() {
+  Submit();
+  return Finish();
+}
 
-  GLint success = false;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  CHECK_GL_PROGRAM_ERROR(success, glGetShaderInfoLog, shader);
+unsigned int ShaderCompiler::Compile(const LoadedSource &source) {
+  unsigned int const shader = glCreateShader(static_cast<GLenum>(source.type));
 
+  const char *text = source.text.c_str();
+  glShaderSource(shader, 1, &text, nullptr);
+  glCompileShader(shader);
   return shader;
 }
 
-} // namespace gib
\ No newline at end of file
+uint64_t ShaderCompiler::SourceHash() const {
+  // FNV-1a over each source's type and text.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  const auto mix = [&hash](const void *data, const size_t size) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ULL;
+    }
+  };
+  for (const LoadedSource &source : sources_) {
+    const auto type = static_cast<GLenum>(source.type);
+    mix(&type, sizeof(type));
+    mix(source.text.data(), source.text.size());
+  }
+  return hash;
+}
+
+} // namespace gib
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "engine/shaders/preprocessor.h"
 #include "engine/shaders/types.h"
 #include "util/report/report.h"
+#include "util/time/time.h"
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
+#include <string>
 #include <vector>
 
 #define GLAD_GL_IMPLEMENTATION
@@ -14,6 +18,14 @@ namespace gib {
 
 class ShaderCompiler {
 public:
+  // Where a loaded source came from, to load it again on a hot reload.
+  struct Origin {
+    std::string shader;
+    ShaderType type;
+    bool is_path;
+    std::string defines;
+  };
+
   ShaderCompiler() = default;
 
   ShaderCompiler(const ShaderCompiler &) = delete;
@@ -22,18 +34,83 @@ public:
   ShaderCompiler(ShaderCompiler &&other) = delete;
   ShaderCompiler &operator=(ShaderCompiler &&other) = delete;
 
-  // Loads and compiles shader. Returns shader ID.
-  unsigned int LoadAndCompile(const ShaderSource &source);
+  // Loads the shader source with its #includes expanded and `defines` (e.g.
+  // "#define SKINNED 1\n") inserted after its #version line. Compiling is
+  // deferred to Submit(), which may not need to if the program binary is
+  // cached.
+  void Load(const ShaderSource &source, const std::string &defines = "");
+
+  // Loads text returned by Preprocess().
+  void LoadPreprocessed(std::string text, ShaderType type);
+
+  // Reads and expands the source `origin` describes. Only does file I/O, so
+  // it may run on any thread.
+  [[nodiscard]] static PreprocessedShader Preprocess(const Origin &origin);
+
+  // Starts building a program from all loaded shaders, loaded from the
+  // ProgramBinaryCache if it has the program, else compiled from source.
+  // Nothing is queried until Finish(), so drivers with
+  // GL_KHR_parallel_shader_compile build it in the background.
+  void Submit();
+
+  // True if the submitted program is built and Finish() will not block.
+  // Without GL_KHR_parallel_shader_compile this cannot be known, so it is
+  // false unless the program was loaded from the cache.
+  [[nodiscard]] bool Poll() const;
+
+  // Waits for the submitted program, checks it linked and stores it in the
+  // ProgramBinaryCache. Returns shader program ID.
+  unsigned int Finish();
+
+  // Like Finish(), but returns 0 if the program failed to link, e.g. to keep
+  // the previous program on a hot reload.
+  unsigned int TryFinish();
 
-  // Links all compiled shaders into a shader program, and deletes the
-  // shaders. Returns shader program ID.
+  // Submit() and Finish(). Returns shader program ID.
   unsigned int Link();
 
+  // True between Submit() and Finish().
+  [[nodiscard]] bool IsPending() const { return program_ != 0; }
+
+  // Sources passed to Load().
+  [[nodiscard]] const std::vector<Origin> &Origins() const {
+    return origins_;
+  }
+  // Files the sources passed to Load() read, including their includes.
+  [[nodiscard]] const std::vector<std::string> &Files() const {
+    return files_;
+  }
+
 private:
-  // Compiles shaders.
-  static unsigned int Compile(const ShaderSource &source, ShaderType type);
+  struct LoadedSource {
+    std::string text;
+    ShaderType type;
+  };
+
+  // Inserts `defines` after the #version line of `text`, which must come
+  // first, or at the start if there is none.
+  static std::string InjectDefines(std::string text,
+                                   const std::string &defines);
+
+  // Finish(), setting `linked` to whether the program linked.
+  unsigned int FinishBuild(bool &linked);
+
+  // Starts compiling a shader, its status is checked by Finish().
+  static unsigned int Compile(const LoadedSource &source);
+
+  // Hash of the types and text of all loaded sources.
+  [[nodiscard]] uint64_t SourceHash() const;
+
+  std::vector<LoadedSource> sources_;
+  std::vector<Origin> origins_;
+  std::vector<std::string> files_;
 
-  std::vector<unsigned int> shaders_;
+  // Submitted program, and its shaders unless loaded from the cache.
+  GLuint program_{0};
+  std::vector<GLuint> shaders_;
+  bool use_cache_{false};
+  uint64_t source_hash_{0};
+  time_util::TimePoint submit_time_;
 };
 
-} // namespace gib
\ No newline at end of file
+} // namespace gib
@@ -0,0 +1,115 @@
+"""Build-time GLSL validation and embedding.
+
+glsl_library() expands the #includes of each shader, strips comments and
+whitespace, validates the result with glslangValidator and generates a
+cc_library header holding the shaders as constexpr EmbeddedShader data:
+
+    glsl_library(
+        name = "flycam_shaders",
+        srcs = ["shaders/flycam.vert", "shaders/flycam.frag"],
+    )
+
+    #include "gib/executables/flycam_shaders.h"
+    Shader shader{ShaderSource(kFlycamVert), ShaderSource(kFlycamFrag)};
+
+The stage comes from the extension: .vert, .frag or .geom. glslangValidator
+is taken from PATH; build with --//engine/shaders:validate_glsl=false to skip
+validation where it is not installed.
+"""
+
+load("@bazel_skylib//rules:common_settings.bzl", "BuildSettingInfo")
+load("@rules_cc//cc:defs.bzl", "cc_library")
+
+def _glsl_embed_impl(ctx):
+    validate = ctx.attr._validate[BuildSettingInfo].value
+    preprocessed = []
+    stamps = []
+    for src in ctx.files.srcs:
+        out = ctx.actions.declare_file(
+            "{}_glsl/{}".format(ctx.label.name, src.basename),
+        )
+        ctx.actions.run(
+            executable = ctx.executable._tool,
+            arguments = ["--preprocess", src.path, out.path],
+            inputs = [src] + ctx.files.includes,
+            outputs = [out],
+            mnemonic = "GlslPreprocess",
+            progress_message = "Preprocessing GLSL %s" % src.short_path,
+        )
+        preprocessed.append(out)
+        if not validate:
+            continue
+
+        # Stamp output so the embed action depends on validation.
+        stamp = ctx.actions.declare_file(out.basename + ".valid", sibling = out)
+        ctx.actions.run_shell(
+            command = 'log=$("$1" "$2" 2>&1) || { echo "$log"; exit 1; }; ' +
+                      'echo "$log" > "$3"',
+            arguments = [ctx.attr.validator, out.path, stamp.path],
+            inputs = [out],
+            outputs = [stamp],
+            # glslangValidator comes from the host.
+            use_default_shell_env = True,
+            mnemonic = "GlslValidate",
+            progress_message = "Validating GLSL %s" % src.short_path,
+        )
+        stamps.append(stamp)
+
+    ctx.actions.run(
+        executable = ctx.executable._tool,
+        arguments = ["--embed", ctx.outputs.out.path] +
+                    [f.path for f in preprocessed],
+        inputs = preprocessed + stamps,
+        outputs = [ctx.outputs.out],
+        mnemonic = "GlslEmbed",
+        progress_message = "Embedding GLSL into %s" % ctx.outputs.out.short_path,
+    )
+    return [DefaultInfo(files = depset([ctx.outputs.out]))]
+
+_glsl_embed = rule(
+    implementation = _glsl_embed_impl,
+    attrs = {
+        "srcs": attr.label_list(
+            allow_files = [".vert", ".frag", ".geom"],
+            mandatory = True,
+        ),
+        "includes": attr.label_list(allow_files = True),
+        "out": attr.output(mandatory = True),
+        "validator": attr.string(default = "glslangValidator"),
+        "_tool": attr.label(
+            default = "//engine/shaders/tools:glsl_embed",
+            executable = True,
+            cfg = "exec",
+        ),
+        "_validate": attr.label(default = "//engine/shaders:validate_glsl"),
+    },
+)
+
+def glsl_library(
+        name,
+        srcs,
+        includes = [],
+        validator = "glslangValidator",
+        visibility = None):
+    """Embeds validated shaders in the header <name>.h.
+
+    Args:
+      name: Name of the cc_library, and of its header.
+      srcs: Shaders to embed, one EmbeddedShader each.
+      includes: Files the shaders #include.
+      validator: glslangValidator executable.
+      visibility: Visibility of the cc_library.
+    """
+    _glsl_embed(
+        name = name + "_embed",
+        srcs = srcs,
+        includes = includes,
+        out = name + ".h",
+        validator = validator,
+    )
+    cc_library(
+        name = name,
+        hdrs = [":" + name + "_embed"],
+        visibility = visibility,
+        deps = ["//engine/shaders:types"],
+    )
@@ -0,0 +1,234 @@
+#include "engine/shaders/hot_reload.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "engine/core/gl_ext.h"
+#include "third_party/imgui/imgui.h"
+#include "util/report/report.h"
+
+namespace gib {
+namespace {
+
+// Poll timeout, bounds how long the destructor waits for the watcher.
+constexpr int kStopCheckMs = 100;
+// Editors often save in several steps (truncate, write, rename), so reload
+// once no event arrived for this long.
+constexpr int kSettleMs = 50;
+
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+} // namespace
+
+ShaderHotReload::ShaderHotReload() {
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) {
+    WARNING("inotify_init1 failed ({}), shader hot reload disabled",
+            std::strerror(errno));
+    return;
+  }
+  watcher_ = std::thread([this]() { WatchLoop(); });
+}
+
+ShaderHotReload::~ShaderHotReload() {
+  stop_ = true;
+  if (watcher_.joinable()) {
+    watcher_.join();
+  }
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+  for (Building &building : building_) {
+    glDeleteProgram(building.compiler->TryFinish());
+  }
+}
+
+void ShaderHotReload::Watch(Shader *shader) {
+  const ShaderCompiler &compiler = shader->GetCompiler();
+  if (compiler.Files().empty()) {
+    DEBUG("Shader program {} reads no files, nothing to watch",
+          shader->GetProgramId());
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  AddWatches(compiler.Files());
+  watched_[shader] = {compiler.Origins(), compiler.Files()};
+}
+
+void ShaderHotReload::Unwatch(Shader *shader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  watched_.erase(shader);
+  reloaded_.erase(std::remove_if(reloaded_.begin(), reloaded_.end(),
+                                 [shader](const Reloaded &reloaded) {
+                                   return reloaded.shader == shader;
+                                 }),
+                  reloaded_.end());
+  for (Building &building : building_) {
+    building.superseded |= building.shader == shader;
+  }
+}
+
+void ShaderHotReload::Update() {
+  std::vector<Reloaded> reloaded;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reloaded.swap(reloaded_);
+  }
+  for (Reloaded &reload : reloaded) {
+    for (Building &building : building_) {
+      building.superseded |= building.shader == reload.shader;
+    }
+    auto compiler = std::make_unique<ShaderCompiler>();
+    for (auto &[text, type] : reload.sources) {
+      compiler->LoadPreprocessed(std::move(text), type);
+    }
+    compiler->Submit();
+    building_.push_back({reload.shader, std::move(compiler), false});
+  }
+
+  // Without parallel compile Poll() cannot tell, so finish right away. A
+  // reload stalls a frame, which is fine while editing shaders.
+  const bool can_poll = GLExtensions::Get().SupportsParallelShaderCompile();
+  auto it = building_.begin();
+  while (it != building_.end()) {
+    if (can_poll && !it->compiler->Poll()) {
+      ++it;
+      continue;
+    }
+    const GLuint program = it->compiler->TryFinish();
+    if (it->superseded) {
+      glDeleteProgram(program);
+    } else if (program == 0) {
+      WARNING("Shader reload failed, keeping program {}",
+              it->shader->GetProgramId());
+      ++failures_;
+    } else {
+      INFO("Reloaded shader, program {} replaces {}", program,
+           it->shader->GetProgramId());
+      it->shader->ReplaceProgram(program);
+      ++reloads_;
+    }
+    it = building_.erase(it);
+  }
+}
+
+void ShaderHotReload::DebugUI() {
+  if (ImGui::CollapsingHeader("Shader Hot Reload")) {
+    size_t watched = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      watched = watched_.size();
+    }
+    ImGui::Text("Enabled: %s", inotify_fd_ >= 0 ? "yes" : "no");
+    ImGui::Text("Watched shaders: %zu", watched);
+    ImGui::Text("Reloads: %zu", reloads_);
+    ImGui::Text("Failed reloads: %zu", failures_.load());
+    ImGui::Text("Building: %zu", building_.size());
+  }
+}
+
+void ShaderHotReload::WatchLoop() {
+  std::unordered_set<std::string> changed;
+  alignas(inotify_event) char buffer[4096];
+  while (!stop_) {
+    pollfd fd{inotify_fd_, POLLIN, 0};
+    const int ready = poll(&fd, 1, changed.empty() ? kStopCheckMs : kSettleMs);
+    if (ready < 0 && errno != EINTR) {
+      WARNING("poll on inotify failed ({}), shader hot reload stopped",
+              std::strerror(errno));
+      return;
+    }
+    if (ready > 0) {
+      const ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (ssize_t offset = 0; offset < length;) {
+        const auto *event = reinterpret_cast<inotify_event *>(buffer + offset);
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        const auto dir = watch_dirs_.find(event->wd);
+        if (event->len > 0 && dir != watch_dirs_.end()) {
+          changed.insert(
+              (std::filesystem::path(dir->second) / event->name).string());
+        }
+      }
+      continue;
+    }
+    if (!changed.empty()) {
+      Reload(changed);
+      changed.clear();
+    }
+  }
+}
+
+void ShaderHotReload::Reload(const std::unordered_set<std::string> &changed) {
+  std::vector<std::pair<Shader *, std::vector<ShaderCompiler::Origin>>>
+      affected;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &[shader, watched] : watched_) {
+      if (std::any_of(watched.files.begin(), watched.files.end(),
+                      [&changed](const std::string &file) {
+                        return changed.count(file) > 0;
+                      })) {
+        affected.emplace_back(shader, watched.origins);
+      }
+    }
+  }
+
+  // File I/O and preprocessing happen here, off the render thread.
+  for (const auto &[shader, origins] : affected) {
+    Reloaded reload{shader, {}};
+    std::vector<std::string> files;
+    bool ok = true;
+    for (const ShaderCompiler::Origin &origin : origins) {
+      PreprocessedShader preprocessed = ShaderCompiler::Preprocess(origin);
+      if (!preprocessed.error.empty()) {
+        WARNING("Shader reload failed: {}", preprocessed.error);
+        ++failures_;
+        ok = false;
+        break;
+      }
+      files.insert(files.end(), preprocessed.files.begin(),
+                   preprocessed.files.end());
+      reload.sources.emplace_back(std::move(preprocessed.text), origin.type);
+    }
+    if (!ok) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto watched = watched_.find(shader);
+    if (watched == watched_.end()) {
+      continue;
+    }
+    // The include graph may have changed.
+    AddWatches(files);
+    watched->second.files = std::move(files);
+    reloaded_.push_back(std::move(reload));
+  }
+}
+
+void ShaderHotReload::AddWatches(const std::vector<std::string> &files) {
+  if (inotify_fd_ < 0) {
+    return;
+  }
+  for (const std::string &file : files) {
+    const std::string dir = std::filesystem::path(file).parent_path().string();
+    if (watched_dirs_.count(dir) > 0) {
+      continue;
+    }
+    const int wd = inotify_add_watch(inotify_fd_, dir.c_str(), kWatchMask);
+    if (wd < 0) {
+      WARNING("Failed to watch {} ({})", dir, std::strerror(errno));
+      continue;
+    }
+    watch_dirs_[wd] = dir;
+    watched_dirs_.insert(dir);
+  }
+}
+
+} // namespace gib
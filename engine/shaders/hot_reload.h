@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "engine/shaders/compiler.h"
+#include "engine/shaders/shader.h"
+#include "engine/shaders/types.h"
+#include "util/macros.h"
+
+namespace gib {
+
+// Rebuilds shaders when a file they read, including their #includes,
+// changes on disk.
+//
+// A watcher thread waits on inotify for writes to the directories of the
+// watched files. Once the writes settle it re-reads and preprocesses the
+// affected shaders, picking up changes to their include graph. Update(),
+// called by the render thread between frames, compiles the new sources and
+// swaps the programs in. A shader that fails to load, compile or link keeps
+// its old program.
+//
+// Linux only, disabled if inotify is unavailable. Owned by the application,
+// after the window so the context outlives it. Everything but the watcher
+// thread runs on the thread owning the GL context.
+class ShaderHotReload {
+public:
+  ShaderHotReload();
+  ~ShaderHotReload();
+
+  // Reloads `shader` when its files change. It must be Unwatch()ed before it
+  // is destroyed.
+  void Watch(Shader *shader);
+  void Unwatch(Shader *shader);
+
+  // Builds the reloaded shaders and swaps in the ones that linked. Call once
+  // per frame, before drawing.
+  void Update();
+
+  void DebugUI();
+
+  DISALLOW_COPY_AND_ASSIGN(ShaderHotReload);
+
+private:
+  struct Watched {
+    std::vector<ShaderCompiler::Origin> origins;
+    // Normalized paths of every file the sources read.
+    std::vector<std::string> files;
+  };
+
+  // Sources preprocessed by the watcher thread.
+  struct Reloaded {
+    Shader *shader;
+    std::vector<std::pair<std::string, ShaderType>> sources;
+  };
+
+  struct Building {
+    Shader *shader;
+    std::unique_ptr<ShaderCompiler> compiler;
+    // A newer build of the same shader was started, or it was unwatched.
+    bool superseded;
+  };
+
+  // Watcher thread.
+  void WatchLoop();
+  void Reload(const std::unordered_set<std::string> &changed);
+
+  // Adds an inotify watch on the directory of each of `files`. `mutex_` must
+  // be held.
+  void AddWatches(const std::vector<std::string> &files);
+
+  int inotify_fd_{-1};
+  std::thread watcher_;
+  std::atomic<bool> stop_{false};
+
+  // Guards the members up to `reloaded_`, shared with the watcher thread.
+  std::mutex mutex_;
+  std::unordered_map<Shader *, Watched> watched_;
+  // Watched directory of each inotify watch descriptor.
+  std::unordered_map<int, std::string> watch_dirs_;
+  std::unordered_set<std::string> watched_dirs_;
+  std::vector<Reloaded> reloaded_;
+
+  // Render thread only.
+  std::vector<Building> building_;
+  size_t reloads_{0};
+  std::atomic<size_t> failures_{0};
+};
+
+} // namespace gib
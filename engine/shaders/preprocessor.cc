@@ -0,0 +1,128 @@
+#include "engine/shaders/preprocessor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <fmt/format.h>
+
+namespace gib {
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string NormalizedPath(const fs::path &path) {
+  std::error_code error;
+  const fs::path absolute = fs::absolute(path, error);
+  return (error ? path : absolute).lexically_normal().string();
+}
+
+bool ReadFile(const std::string &path, std::string &text) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  text = stream.str();
+  return true;
+}
+
+// Path of an `#include "path"` or `#include <path>` line, or empty.
+std::string IncludePath(const std::string &line) {
+  size_t pos = line.find_first_not_of(" \t");
+  if (pos == std::string::npos || line[pos] != '#') {
+    return "";
+  }
+  pos = line.find_first_not_of(" \t", pos + 1);
+  if (pos == std::string::npos || line.compare(pos, 7, "include") != 0) {
+    return "";
+  }
+  pos = line.find_first_not_of(" \t", pos + 7);
+  if (pos == std::string::npos || (line[pos] != '"' && line[pos] != '<')) {
+    return "";
+  }
+  const char close = line[pos] == '"' ? '"' : '>';
+  const size_t end = line.find(close, pos + 1);
+  return end == std::string::npos ? "" : line.substr(pos + 1, end - pos - 1);
+}
+
+class Expander {
+public:
+  explicit Expander(PreprocessedShader &result) : result_(result) {}
+
+  // Appends `text` of file `name` with its includes expanded. `source` is
+  // its source string number for #line directives.
+  bool Expand(const std::string &text, const std::string &name,
+              const fs::path &directory, const size_t source) {
+    std::istringstream lines(text);
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(lines, line)) {
+      ++line_number;
+      const std::string include = IncludePath(line);
+      if (include.empty()) {
+        result_.text += line;
+        result_.text += '\n';
+        continue;
+      }
+      const std::string path = NormalizedPath(directory / include);
+      if (std::find(result_.files.begin(), result_.files.end(), path) !=
+          result_.files.end()) {
+        // Already included, keep the line count.
+        result_.text += '\n';
+        continue;
+      }
+      std::string included;
+      if (!ReadFile(path, included)) {
+        result_.error = fmt::format("{}:{}: failed to open include {}", name,
+                                    line_number, path);
+        return false;
+      }
+      result_.files.push_back(path);
+      const size_t included_source = result_.files.size() - 1 + offset_;
+      result_.text += fmt::format("#line 1 {}\n", included_source);
+      if (!Expand(included, path, fs::path(path).parent_path(),
+                  included_source)) {
+        return false;
+      }
+      result_.text += fmt::format("#line {} {}\n", line_number + 1, source);
+    }
+    return true;
+  }
+
+  // Source string numbers are offset by one if the text had no file.
+  void SetOffset(const size_t offset) { offset_ = offset; }
+
+private:
+  PreprocessedShader &result_;
+  size_t offset_{0};
+};
+
+} // namespace
+
+PreprocessedShader PreprocessShaderFile(const std::string &path) {
+  PreprocessedShader result;
+  const std::string normalized = NormalizedPath(path);
+  std::string text;
+  if (!ReadFile(normalized, text)) {
+    result.error = fmt::format("failed to open {}", normalized);
+    return result;
+  }
+  result.files.push_back(normalized);
+  Expander expander(result);
+  expander.Expand(text, normalized, fs::path(normalized).parent_path(), 0);
+  return result;
+}
+
+PreprocessedShader PreprocessShaderText(const std::string &text,
+                                        const std::string &directory) {
+  PreprocessedShader result;
+  Expander expander(result);
+  expander.SetOffset(1);
+  expander.Expand(text, "<inline>", fs::path(directory), 0);
+  return result;
+}
+
+} // namespace gib
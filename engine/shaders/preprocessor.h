@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace gib {
+
+// Shader text with its includes expanded.
+struct PreprocessedShader {
+  std::string text;
+  // Normalized absolute paths of every file read, the shader's own file (if
+  // any) first. Source string numbers in #line directives index this list,
+  // offset by one if the shader was not read from a file.
+  std::vector<std::string> files;
+  // Empty on success.
+  std::string error;
+};
+
+// Expands `#include "path"` directives, resolved relative to the including
+// file. Each file is included at most once per shader, so include guards are
+// not needed and cycles are harmless. #line directives keep compile errors
+// pointing at the line in the original file. Only does file I/O, so it may
+// run on any thread.
+PreprocessedShader PreprocessShaderFile(const std::string &path);
+
+// As above for shader text, with includes resolved relative to `directory`.
+PreprocessedShader PreprocessShaderText(const std::string &text,
+                                        const std::string &directory);
+
+} // namespace gib
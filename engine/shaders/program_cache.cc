@@ -0,0 +1,182 @@
+#include "engine/shaders/program_cache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "third_party/imgui/imgui.h"
+#include "util/report/report.h"
+
+namespace gib {
+namespace {
+
+// Identifies cache entries and their layout.
+constexpr uint32_t kEntryMagic = 0x47494250; // "GIBP"
+constexpr uint32_t kEntryVersion = 1;
+
+struct EntryHeader {
+  uint32_t magic;
+  uint32_t version;
+  GLenum format;
+  uint32_t size;
+};
+
+// FNV-1a, continuing from `hash`.
+uint64_t HashBytes(const void *data, const size_t size,
+                   uint64_t hash = 0xcbf29ce484222325ULL) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint64_t HashGlString(const GLenum name, const uint64_t hash) {
+  const auto *str = reinterpret_cast<const char *>(glGetString(name));
+  return str != nullptr ? HashBytes(str, std::strlen(str), hash) : hash;
+}
+
+} // namespace
+
+ProgramBinaryCache::ProgramBinaryCache(std::string directory)
+    : directory_(std::move(directory)) {
+  ASSERT(current_ == nullptr,
+         "Only one ProgramBinaryCache may exist at a time");
+  current_ = this;
+
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats == 0) {
+    WARNING("Driver supports no program binary formats, cache disabled");
+    return;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) {
+    WARNING("Failed to create shader cache {}: {}", directory_,
+            error.message());
+    return;
+  }
+  driver_hash_ = HashGlString(GL_VENDOR, 0xcbf29ce484222325ULL);
+  driver_hash_ = HashGlString(GL_RENDERER, driver_hash_);
+  driver_hash_ = HashGlString(GL_VERSION, driver_hash_);
+  enabled_ = true;
+}
+
+ProgramBinaryCache::~ProgramBinaryCache() {
+  INFO("Shader programs: {} from binary in {:.1f} ms, {} from source in "
+       "{:.1f} ms",
+       warm_builds_, 1e-3 * static_cast<double>(warm_time_.count()),
+       cold_builds_, 1e-3 * static_cast<double>(cold_time_.count()));
+  current_ = nullptr;
+}
+
+std::string ProgramBinaryCache::EntryPath(const uint64_t source_hash) const {
+  const uint64_t key =
+      HashBytes(&source_hash, sizeof(source_hash), driver_hash_);
+  return fmt::format("{}/{:016x}.bin", directory_, key);
+}
+
+GLuint ProgramBinaryCache::Load(const uint64_t source_hash) {
+  if (!enabled_) {
+    return 0;
+  }
+  const std::string path = EntryPath(source_hash);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return 0;
+  }
+  EntryHeader header{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  std::vector<char> binary;
+  if (file && header.magic == kEntryMagic && header.version == kEntryVersion) {
+    binary.resize(header.size);
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+  }
+  if (!file || binary.empty()) {
+    WARNING("Dropping malformed shader cache entry {}", path);
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return 0;
+  }
+
+  const GLuint program = glCreateProgram();
+  glProgramBinary(program, header.format, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint success = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (success == GL_FALSE) {
+    // E.g. the driver changed without its version string changing.
+    DEBUG("Driver rejected shader cache entry {}", path);
+    ++rejected_binaries_;
+    glDeleteProgram(program);
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return 0;
+  }
+  return program;
+}
+
+void ProgramBinaryCache::Store(const uint64_t source_hash,
+                               const GLuint program) {
+  if (!enabled_) {
+    return;
+  }
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(static_cast<size_t>(length));
+  EntryHeader header{kEntryMagic, kEntryVersion, 0, 0};
+  GLsizei written = 0;
+  glGetProgramBinary(program, length, &written, &header.format,
+                     binary.data());
+  header.size = static_cast<uint32_t>(written);
+
+  const std::string path = EntryPath(source_hash);
+  // Write to a temporary file first so a crash never leaves a partial entry.
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.data(), written);
+    if (!file) {
+      WARNING("Failed to write shader cache entry {}", tmp_path);
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp_path, path, error);
+  if (error) {
+    WARNING("Failed to store shader cache entry {}: {}", path,
+            error.message());
+  }
+}
+
+void ProgramBinaryCache::RecordBuild(const bool from_binary,
+                                     const time_util::DurationUsec duration) {
+  if (from_binary) {
+    ++warm_builds_;
+    warm_time_ += duration;
+  } else {
+    ++cold_builds_;
+    cold_time_ += duration;
+  }
+}
+
+void ProgramBinaryCache::DebugUI() {
+  if (ImGui::CollapsingHeader("Shader Program Cache")) {
+    ImGui::Text("Enabled: %s (%s)", enabled_ ? "yes" : "no",
+                directory_.c_str());
+    ImGui::Text("From binary: %zu in %.1f ms", warm_builds_,
+                1e-3f * static_cast<float>(warm_time_.count()));
+    ImGui::Text("From source: %zu in %.1f ms", cold_builds_,
+                1e-3f * static_cast<float>(cold_time_.count()));
+    ImGui::Text("Rejected binaries: %zu", rejected_binaries_);
+  }
+}
+
+} // namespace gib
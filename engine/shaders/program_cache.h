@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define GLAD_GL_IMPLEMENTATION
+#include "third_party/glad/glad.h"
+
+#include "util/macros.h"
+#include "util/time/time.h"
+
+namespace gib {
+
+// On-disk cache of linked program binaries (glGetProgramBinary), so programs
+// only compile from source the first time they are built with a driver.
+//
+// Entries are keyed by a hash of the program's preprocessed sources (which
+// include any injected defines) combined with the GL vendor, renderer and
+// version strings, so a driver update invalidates them. A binary the driver
+// rejects is deleted and the program is compiled from source again.
+//
+// Owned by the application, after the window so the context outlives it.
+// ShaderCompiler::Submit() uses the Current() cache if there is one. Must
+// only be used from the thread owning the GL context.
+class ProgramBinaryCache {
+public:
+  // Binaries are stored in `directory`, which is created if needed.
+  explicit ProgramBinaryCache(std::string directory);
+  ~ProgramBinaryCache();
+
+  // The cache, or nullptr if the application did not create one.
+  [[nodiscard]] static ProgramBinaryCache *Current() { return current_; }
+
+  // False if the driver supports no binary formats.
+  [[nodiscard]] bool IsEnabled() const { return enabled_; }
+
+  // Returns a linked program for `source_hash`, or 0 on a miss.
+  [[nodiscard]] GLuint Load(uint64_t source_hash);
+
+  // Stores the binary of `program`, which must have been linked with
+  // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+  void Store(uint64_t source_hash, GLuint program);
+
+  // Startup counters, `from_binary` if Load() hit.
+  void RecordBuild(bool from_binary, time_util::DurationUsec duration);
+
+  void DebugUI();
+
+  DISALLOW_COPY_AND_ASSIGN(ProgramBinaryCache);
+
+private:
+  [[nodiscard]] std::string EntryPath(uint64_t source_hash) const;
+
+  static inline ProgramBinaryCache *current_ = nullptr;
+
+  const std::string directory_;
+  bool enabled_{false};
+  // Hash of the driver strings, mixed into every key.
+  uint64_t driver_hash_{0};
+
+  size_t warm_builds_{0};
+  size_t cold_builds_{0};
+  size_t rejected_binaries_{0};
+  time_util::DurationUsec warm_time_{0};
+  time_util::DurationUsec cold_time_{0};
+};
+
+} // namespace gib
@@ -6,14 +6,46 @@
 namespace gib {
 
 Shader::Shader(const ShaderSource &source) {
-  shader_compiler_.LoadAndCompile(source);
+  shader_compiler_.Load(source);
 }
 
 Shader::Shader(const ShaderSource &source1, const ShaderSource &source2) {
-  shader_compiler_.LoadAndCompile(source1);
-  shader_compiler_.LoadAndCompile(source2);
+  shader_compiler_.Load(source1);
+  shader_compiler_.Load(source2);
 }
 
-void Shader::Link() { shader_program_ = shader_compiler_.Link(); }
+Shader::Shader(const std::vector<ShaderSource> &sources,
+               const std::string &defines) {
+  for (const ShaderSource &source : sources) {
+    shader_compiler_.Load(source, defines);
+  }
+}
+
+void Shader::Link() {
+  LinkAsync();
+  FinishLink();
+}
+
+void Shader::LinkAsync() { shader_compiler_.Submit(); }
+
+bool Shader::PollLink() {
+  if (shader_compiler_.IsPending() && shader_compiler_.Poll()) {
+    FinishLink();
+  }
+  return IsReady();
+}
+
+void Shader::FinishLink() {
+  shader_program_ = shader_compiler_.Finish();
+  uniforms_.Reflect(shader_program_);
+}
+
+void Shader::ReplaceProgram(const GLuint program) {
+  if (shader_program_ != 0) {
+    GLCore::Current().DeleteProgram(shader_program_);
+  }
+  shader_program_ = program;
+  uniforms_.Reflect(shader_program_);
+}
 
 } // namespace gib
\ No newline at end of file
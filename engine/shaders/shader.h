@@ -4,12 +4,17 @@
 #define GLAD_GL_IMPLEMENTATION
 #include "third_party/glad/glad.h"
 
+#include "engine/core/gl_core.h"
 #include "engine/shaders/compiler.h"
 #include "engine/shaders/types.h"
+#include "engine/shaders/uniform_table.h"
 #include "util/report/report.h"
 
 #include <glm/glm.hpp>
 
+#include <string>
+#include <vector>
+
 namespace gib {
 
 class Shader {
@@ -17,6 +22,8 @@ public:
   Shader() = default;
   explicit Shader(const ShaderSource &source);
   Shader(const ShaderSource &source1, const ShaderSource &source2);
+  // `defines` are inserted after the #version line of every source.
+  Shader(const std::vector<ShaderSource> &sources, const std::string &defines);
 
   ~Shader() = default;
 
@@ -24,55 +31,137 @@ public:
     return shader_program_;
   }
 
+  // Builds the program, blocking until it is linked.
   void Link();
 
-  void Activate() const { glUseProgram(shader_program_); }
-  static void Deactivate() { glUseProgram(0); }
+  // Starts building the program without blocking. The shader cannot be used
+  // until IsReady(); PollLink() it every frame, e.g. through a
+  // ShaderBuildQueue, or FinishLink() to wait for it.
+  void LinkAsync();
+  // Finishes the build if the driver completed it. Returns IsReady().
+  bool PollLink();
+  // Blocks until the build started by LinkAsync() completes.
+  void FinishLink();
+
+  // True once the program is linked and the shader can be drawn with.
+  [[nodiscard]] bool IsReady() const { return shader_program_ != 0; }
+
+  // Deletes the current program and uses `program` instead, e.g. rebuilt by
+  // ShaderHotReload. Call between frames.
+  void ReplaceProgram(GLuint program);
+
+  // Sources and files the program is built from.
+  [[nodiscard]] const ShaderCompiler &GetCompiler() const {
+    return shader_compiler_;
+  }
+
+  void Activate() const { GLCore::Current().UseProgram(shader_program_); }
+  static void Deactivate() { GLCore::Current().UseProgram(0); }
 
   void UpdateUniforms();
 
-  // Utility uniform functions
-  void SetBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(shader_program_, name.c_str()),
-                static_cast<int>(value));
+  // Active uniforms and uniform blocks, read by Link().
+  [[nodiscard]] const UniformTable &GetUniformTable() const {
+    return uniforms_;
   }
 
-  void SetInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(shader_program_, name.c_str()), value);
+  // Utility uniform functions. The program must be active. Uploads are
+  // skipped if the uniform is not active or already holds `value`. Prefer
+  // the UniformHandle overloads with a constexpr handle on hot paths, the
+  // string overloads hash the name on every call.
+  void SetBool(const UniformHandle handle, const bool value) const {
+    SetInt(handle, static_cast<int>(value));
   }
 
-  void SetFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(shader_program_, name.c_str()), value);
+  void SetInt(const UniformHandle handle, const int value) const {
+    if (const GLint location = uniforms_.Changed(handle, value);
+        location >= 0) {
+      glUniform1i(location, value);
+    }
   }
 
-  void SetVec2(const std::string &name, const glm::vec2 &value) const {
-    glUniform2fv(glGetUniformLocation(shader_program_, name.c_str()), 1,
-                 &value[0]);
+  void SetUint(const UniformHandle handle, const unsigned int value) const {
+    if (const GLint location = uniforms_.Changed(handle, value);
+        location >= 0) {
+      glUniform1ui(location, value);
+    }
   }
 
-  void SetVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(shader_program_, name.c_str()), 1,
-                 &value[0]);
+  void SetFloat(const UniformHandle handle, const float value) const {
+    if (const GLint location = uniforms_.Changed(handle, value);
+        location >= 0) {
+      glUniform1f(location, value);
+    }
   }
 
-  void SetVec4(const std::string &name, const glm::vec4 &value) const {
-    glUniform4fv(glGetUniformLocation(shader_program_, name.c_str()), 1,
-                 &value[0]);
+  void SetVec2(const UniformHandle handle, const glm::vec2 &value) const {
+    if (const GLint location = uniforms_.Changed(handle, value);
+        location >= 0) {
+      glUniform2fv(location, 1, &value[0]);
+    }
   }
 
-  void SetMat2(const std::string &name, const glm::mat2 &mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(shader_program_, name.c_str()), 1,
-                       GL_FALSE, &mat[0][0]);
+  void SetVec3(const UniformHandle handle, const glm::vec3 &value) const {
+    if (const GLint location = uniforms_.Changed(handle, value);
+        location >= 0) {
+      glUniform3fv(location, 1, &value[0]);
+    }
   }
 
-  void SetMat3(const std::string &name, const glm::mat3 &mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(shader_program_, name.c_str()), 1,
-                       GL_FALSE, &mat[0][0]);
+  void SetVec4(const UniformHandle handle, const glm::vec4 &value) const {
+    if (const GLint location = uniforms_.Changed(handle, value);
+        location >= 0) {
+      glUniform4fv(location, 1, &value[0]);
+    }
+  }
+
+  void SetMat2(const UniformHandle handle, const glm::mat2 &mat) const {
+    if (const GLint location = uniforms_.Changed(handle, mat); location >= 0) {
+      glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+  }
+
+  void SetMat3(const UniformHandle handle, const glm::mat3 &mat) const {
+    if (const GLint location = uniforms_.Changed(handle, mat); location >= 0) {
+      glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+  }
+
+  void SetMat4(const UniformHandle handle, const glm::mat4 &mat) const {
+    if (const GLint location = uniforms_.Changed(handle, mat); location >= 0) {
+      glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
   }
 
+  void SetBool(const std::string &name, bool value) const {
+    SetBool(UniformHandle(name), value);
+  }
+  void SetInt(const std::string &name, int value) const {
+    SetInt(UniformHandle(name), value);
+  }
+  void SetUint(const std::string &name, unsigned int value) const {
+    SetUint(UniformHandle(name), value);
+  }
+  void SetFloat(const std::string &name, float value) const {
+    SetFloat(UniformHandle(name), value);
+  }
+  void SetVec2(const std::string &name, const glm::vec2 &value) const {
+    SetVec2(UniformHandle(name), value);
+  }
+  void SetVec3(const std::string &name, const glm::vec3 &value) const {
+    SetVec3(UniformHandle(name), value);
+  }
+  void SetVec4(const std::string &name, const glm::vec4 &value) const {
+    SetVec4(UniformHandle(name), value);
+  }
+  void SetMat2(const std::string &name, const glm::mat2 &mat) const {
+    SetMat2(UniformHandle(name), mat);
+  }
+  void SetMat3(const std::string &name, const glm::mat3 &mat) const {
+    SetMat3(UniformHandle(name), mat);
+  }
   void SetMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(shader_program_, name.c_str()), 1,
-                       GL_FALSE, &mat[0][0]);
+    SetMat4(UniformHandle(name), mat);
   }
 
   DISALLOW_COPY_AND_ASSIGN(Shader);
@@ -80,6 +169,8 @@ public:
 protected:
   ShaderCompiler shader_compiler_{};
   unsigned int shader_program_{0};
+  // Setters are const but remember the values they upload.
+  mutable UniformTable uniforms_;
 };
 
 } // namespace gib
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "engine/shaders/shader_variants.h"
+
+#include <algorithm>
+
+#include "third_party/imgui/imgui.h"
+#include "util/report/report.h"
+
+namespace gib {
+
+ShaderVariants::ShaderVariants(const std::vector<ShaderSource> &sources,
+                               std::vector<std::string> features)
+    : features_(std::move(features)) {
+  ASSERT(features_.size() <= kMaxShaderFeatures,
+         "{} shader features, at most {} are supported", features_.size(),
+         kMaxShaderFeatures);
+  sources_.reserve(sources.size());
+  for (const ShaderSource &source : sources) {
+    sources_.push_back({source.shader, source.type, source.is_path});
+  }
+}
+
+ShaderFeatures ShaderVariants::Feature(const std::string &feature) const {
+  const auto it = std::find(features_.begin(), features_.end(), feature);
+  if (it == features_.end()) {
+    THROW_FATAL("Unknown shader feature {}", feature);
+  }
+  return ShaderFeatures{1} << (it - features_.begin());
+}
+
+Shader *ShaderVariants::Get(const ShaderFeatures features,
+                            ShaderBuildQueue *queue) {
+  if (const auto it = variants_.find(features); it != variants_.end()) {
+    return it->second.get();
+  }
+  ASSERT(features_.size() == kMaxShaderFeatures ||
+             (features >> features_.size()) == 0,
+         "Shader features {:#x} include unknown bits", features);
+
+  std::vector<ShaderSource> sources;
+  sources.reserve(sources_.size());
+  for (const OwnedSource &source : sources_) {
+    sources.emplace_back(source.shader.c_str(), source.type, source.is_path);
+  }
+  auto shader = std::make_unique<Shader>(sources, Defines(features));
+  DEBUG("Building shader variant {:#x}", features);
+  if (queue != nullptr) {
+    queue->Add(shader.get());
+  } else {
+    shader->Link();
+  }
+  return variants_.emplace(features, std::move(shader)).first->second.get();
+}
+
+std::string ShaderVariants::Defines(const ShaderFeatures features) const {
+  std::string defines;
+  for (size_t i = 0; i < features_.size(); ++i) {
+    if ((features >> i) & 1) {
+      defines += fmt::format("#define {} 1\n", features_[i]);
+    }
+  }
+  return defines;
+}
+
+void ShaderVariants::DebugUI() const {
+  ImGui::Text("Variants built: %zu", variants_.size());
+  for (const auto &[features, shader] : variants_) {
+    ImGui::Text("%#010x: %s", features,
+                shader->IsReady() ? "ready" : "building");
+  }
+}
+
+} // namespace gib
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "engine/shaders/build_queue.h"
+#include "engine/shaders/shader.h"
+#include "engine/shaders/types.h"
+#include "util/macros.h"
+
+namespace gib {
+
+// Bitmask of the features of a shader variant, bit i is the i-th feature
+// name given to ShaderVariants.
+using ShaderFeatures = uint32_t;
+static constexpr size_t kMaxShaderFeatures = 32;
+
+// Permutations of one set of shader sources. Each feature is a define, e.g.
+// NORMAL_MAP or ALPHA_TEST, and a variant is built the first time its
+// combination of features is requested, with "#define <feature> 1" inserted
+// after the #version line for each enabled feature. Sources select code with
+// #ifdef, so every draw gets the cheapest variant without building all
+// 2^features of them up front.
+//
+// The defines are part of the hashed source text, so each variant is stored
+// separately in the ProgramBinaryCache.
+//
+// Variants live as long as this object. Must only be used from the thread
+// owning the GL context.
+class ShaderVariants {
+public:
+  ShaderVariants(const std::vector<ShaderSource> &sources,
+                 std::vector<std::string> features);
+
+  // Bit of `feature`, which must be one of the feature names.
+  [[nodiscard]] ShaderFeatures Feature(const std::string &feature) const;
+
+  // The variant with `features`, built on first use. If `queue` is given the
+  // variant builds in the background and is not IsReady() until the queue
+  // finishes it, else this blocks until it is linked.
+  Shader *Get(ShaderFeatures features, ShaderBuildQueue *queue = nullptr);
+
+  // Variants built so far.
+  [[nodiscard]] size_t Size() const { return variants_.size(); }
+
+  void DebugUI() const;
+
+  DISALLOW_COPY_AND_ASSIGN(ShaderVariants);
+
+private:
+  // ShaderSource only points at its text, so keep copies.
+  struct OwnedSource {
+    std::string shader;
+    ShaderType type;
+    bool is_path;
+  };
+
+  // "#define <feature> 1" lines of the features in `features`.
+  [[nodiscard]] std::string Defines(ShaderFeatures features) const;
+
+  std::vector<OwnedSource> sources_;
+  std::vector<std::string> features_;
+  std::unordered_map<ShaderFeatures, std::unique_ptr<Shader>> variants_;
+};
+
+} // namespace gib
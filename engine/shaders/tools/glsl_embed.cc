@@ -0,0 +1,200 @@
+// Build-time GLSL tool used by glsl_library (engine/shaders/glsl.bzl).
+//
+//   glsl_embed --preprocess <in> <out>
+//     Expands #includes, strips comments, #line directives, indentation and
+//     blank lines.
+//   glsl_embed --embed <header> <shader>...
+//     Writes a header with each preprocessed shader as a constexpr
+//     EmbeddedShader named after its file, e.g. flycam.vert -> kFlycamVert.
+
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "engine/shaders/preprocessor.h"
+
+namespace gib {
+namespace {
+
+constexpr const char *kRawDelimiter = "GLSL";
+
+// Removes `//` and `/* */` comments, keeping the newlines inside block
+// comments so directives stay on their own lines. GLSL has no string
+// literals, so no other context needs tracking.
+std::string StripComments(const std::string &text) {
+  std::string out;
+  out.reserve(text.size());
+  size_t i = 0;
+  while (i < text.size()) {
+    if (text.compare(i, 2, "//") == 0) {
+      i = text.find('\n', i);
+      if (i == std::string::npos) {
+        break;
+      }
+    } else if (text.compare(i, 2, "/*") == 0) {
+      const size_t end = text.find("*/", i + 2);
+      const size_t stop = end == std::string::npos ? text.size() : end + 2;
+      for (; i < stop; ++i) {
+        if (text[i] == '\n') {
+          out += '\n';
+        }
+      }
+      out += ' ';
+    } else {
+      out += text[i++];
+    }
+  }
+  return out;
+}
+
+// Trims lines, collapses runs of whitespace and drops blank lines and
+// #line directives, which no longer match once lines are dropped.
+std::string StripWhitespace(const std::string &text) {
+  std::istringstream lines(text);
+  std::string line;
+  std::string out;
+  while (std::getline(lines, line)) {
+    std::string collapsed;
+    for (const char c : line) {
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        if (!collapsed.empty() && collapsed.back() != ' ') {
+          collapsed += ' ';
+        }
+      } else {
+        collapsed += c;
+      }
+    }
+    if (!collapsed.empty() && collapsed.back() == ' ') {
+      collapsed.pop_back();
+    }
+    if (collapsed.empty() || collapsed.rfind("#line", 0) == 0) {
+      continue;
+    }
+    out += collapsed;
+    out += '\n';
+  }
+  return out;
+}
+
+// ShaderType enumerator for the file extension glslangValidator also uses to
+// pick the stage, or nullptr.
+const char *ShaderTypeName(const std::string &extension) {
+  if (extension == ".vert") {
+    return "VERTEX";
+  }
+  if (extension == ".frag") {
+    return "FRAGMENT";
+  }
+  if (extension == ".geom") {
+    return "GEOMETRY";
+  }
+  return nullptr;
+}
+
+// "flycam.vert" -> "kFlycamVert".
+std::string SymbolName(const std::string &file_name) {
+  std::string symbol = "k";
+  bool upper = true;
+  for (const char c : file_name) {
+    if (!std::isalnum(static_cast<unsigned char>(c))) {
+      upper = true;
+      continue;
+    }
+    symbol += upper ? static_cast<char>(std::toupper(c)) : c;
+    upper = false;
+  }
+  return symbol;
+}
+
+bool ReadFile(const std::string &path, std::string &text) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  text = stream.str();
+  return true;
+}
+
+bool WriteFile(const std::string &path, const std::string &text) {
+  std::ofstream file(path, std::ios::trunc);
+  file << text;
+  return static_cast<bool>(file);
+}
+
+int Preprocess(const std::string &in, const std::string &out) {
+  const PreprocessedShader preprocessed = PreprocessShaderFile(in);
+  if (!preprocessed.error.empty()) {
+    fmt::print(stderr, "{}\n", preprocessed.error);
+    return 1;
+  }
+  if (!WriteFile(out, StripWhitespace(StripComments(preprocessed.text)))) {
+    fmt::print(stderr, "Failed to write {}\n", out);
+    return 1;
+  }
+  return 0;
+}
+
+int Embed(const std::string &header, const std::vector<std::string> &shaders) {
+  std::string out =
+      "// Generated by //engine/shaders/tools:glsl_embed, do not edit.\n"
+      "#pragma once\n\n"
+      "#include \"engine/shaders/types.h\"\n\n"
+      "namespace gib {\n";
+  const std::string terminator = fmt::format("){}\"", kRawDelimiter);
+  for (const std::string &path : shaders) {
+    const std::filesystem::path file(path);
+    const char *type = ShaderTypeName(file.extension().string());
+    if (type == nullptr) {
+      fmt::print(stderr,
+                 "{}: unknown shader stage, use .vert, .frag or .geom\n",
+                 path);
+      return 1;
+    }
+    std::string text;
+    if (!ReadFile(path, text)) {
+      fmt::print(stderr, "Failed to read {}\n", path);
+      return 1;
+    }
+    if (text.find(terminator) != std::string::npos) {
+      fmt::print(stderr, "{}: contains {}\n", path, terminator);
+      return 1;
+    }
+    const std::string name = file.filename().string();
+    out += fmt::format("\ninline constexpr EmbeddedShader {}{{\n"
+                       "    \"{}\", ShaderType::{},\n"
+                       "    R\"{}({}){}\"}};\n",
+                       SymbolName(name), name, type, kRawDelimiter, text,
+                       kRawDelimiter);
+  }
+  out += "\n} // namespace gib\n";
+  if (!WriteFile(header, out)) {
+    fmt::print(stderr, "Failed to write {}\n", header);
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace
+} // namespace gib
+
+int main(int argc, char **argv) {
+  const std::vector<std::string> args(argv + 1, argv + argc);
+  if (args.size() == 3 && args[0] == "--preprocess") {
+    return gib::Preprocess(args[1], args[2]);
+  }
+  if (args.size() >= 2 && args[0] == "--embed") {
+    return gib::Embed(args[1], {args.begin() + 2, args.end()});
+  }
+  fmt::print(stderr, "Usage: {} --preprocess <in> <out>\n"
+                     "       {} --embed <header> <shader>...\n",
+             argv[0], argv[0]);
+  return 2;
+}
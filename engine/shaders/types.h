@@ -11,10 +11,21 @@ enum class ShaderType : GLenum {
   GEOMETRY = GL_GEOMETRY_SHADER,
 };
 
+// Shader compiled into the binary by glsl_library (glsl.bzl), already
+// validated, with includes expanded and comments stripped.
+struct EmbeddedShader {
+  const char *name;
+  ShaderType type;
+  const char *text;
+};
+
 struct ShaderSource {
   ShaderSource(const char *shader, const ShaderType type,
                const bool is_path = false)
       : shader(shader), type(type), is_path(is_path) {}
+  // Loads from the embedded text, no file I/O.
+  explicit ShaderSource(const EmbeddedShader &embedded)
+      : shader(embedded.text), type(embedded.type), is_path(false) {}
 
   const char *shader;
   ShaderType type;
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define GLAD_GL_IMPLEMENTATION
+#include "third_party/glad/glad.h"
+
+#include "util/report/report.h"
+
+namespace gib {
+
+// FNV-1a hash of a uniform name, usable at compile time.
+constexpr uint64_t HashUniformName(const std::string_view name) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const char c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Uniform or uniform block name, hashed once. Declare as constexpr so the
+// per-draw path does no string work:
+//   static constexpr UniformHandle kModel("u_Model");
+struct UniformHandle {
+  constexpr explicit UniformHandle(const std::string_view name)
+      : hash(HashUniformName(name)) {}
+
+  uint64_t hash;
+};
+
+// Active uniforms and uniform blocks of a linked program, sorted by name hash.
+// Also remembers the last value set for each uniform, so setting an unchanged
+// value can be skipped.
+class UniformTable {
+public:
+  // Largest cached value, a mat4.
+  static constexpr size_t kMaxValueBytes = 64;
+
+  struct Uniform {
+    uint64_t hash;
+    GLint location;
+    GLenum type;
+    // Array length, 1 for non-arrays.
+    GLint size;
+    std::string name;
+    // Last value set, valid if `has_value`.
+    std::array<unsigned char, kMaxValueBytes> value;
+    bool has_value;
+  };
+
+  struct UniformBlock {
+    uint64_t hash;
+    GLuint index;
+    GLint data_size;
+    GLint binding;
+    std::string name;
+  };
+
+  // Reads the active uniforms and uniform blocks of `program`. Uniforms inside
+  // blocks are only listed through their block. Arrays are listed by their
+  // name without "[0]" and map to the location of the first element.
+  void Reflect(const GLuint program) {
+    uniforms_.clear();
+    blocks_.clear();
+
+    GLint count = 0;
+    GLint max_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    std::string name(static_cast<size_t>(std::max(max_length, 1)), '\0');
+    for (GLint i = 0; i < count; ++i) {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(program, static_cast<GLuint>(i), max_length, &length,
+                         &size, &type, name.data());
+      std::string uniform_name = name.substr(0, static_cast<size_t>(length));
+      const GLint location =
+          glGetUniformLocation(program, uniform_name.c_str());
+      if (location < 0) {
+        continue;
+      }
+      if (uniform_name.size() > 3 &&
+          uniform_name.compare(uniform_name.size() - 3, 3, "[0]") == 0) {
+        uniform_name.resize(uniform_name.size() - 3);
+      }
+      uniforms_.push_back({HashUniformName(uniform_name), location, type, size,
+                           std::move(uniform_name), {}, false});
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH,
+                   &max_length);
+    name.assign(static_cast<size_t>(std::max(max_length, 1)), '\0');
+    for (GLint i = 0; i < count; ++i) {
+      const auto index = static_cast<GLuint>(i);
+      GLsizei length = 0;
+      glGetActiveUniformBlockName(program, index, max_length, &length,
+                                  name.data());
+      GLint data_size = 0;
+      GLint binding = 0;
+      glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE,
+                                &data_size);
+      glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_BINDING,
+                                &binding);
+      std::string block_name = name.substr(0, static_cast<size_t>(length));
+      blocks_.push_back({HashUniformName(block_name), index, data_size,
+                         binding, std::move(block_name)});
+    }
+
+    SortByHash(uniforms_);
+    SortByHash(blocks_);
+    DEBUG("Program {}: {} uniforms, {} uniform blocks", program,
+          uniforms_.size(), blocks_.size());
+  }
+
+  // Returns nullptr if `handle` is not an active uniform.
+  [[nodiscard]] const Uniform *Find(const UniformHandle handle) const {
+    return FindByHash(uniforms_, handle.hash);
+  }
+
+  [[nodiscard]] const UniformBlock *
+  FindBlock(const UniformHandle handle) const {
+    return FindByHash(blocks_, handle.hash);
+  }
+
+  // Location to upload `value` to, or -1 if the uniform is not active or
+  // already holds `value`.
+  template <typename T>
+  [[nodiscard]] GLint Changed(const UniformHandle handle, const T &value) {
+    static_assert(sizeof(T) <= kMaxValueBytes, "Uniform value too large");
+    Uniform *uniform = FindByHash(uniforms_, handle.hash);
+    if (uniform == nullptr) {
+      return -1;
+    }
+    if (uniform->has_value &&
+        std::memcmp(uniform->value.data(), &value, sizeof(T)) == 0) {
+      ++skipped_uploads_;
+      return -1;
+    }
+    std::memcpy(uniform->value.data(), &value, sizeof(T));
+    uniform->has_value = true;
+    return uniform->location;
+  }
+
+  [[nodiscard]] const std::vector<Uniform> &Uniforms() const {
+    return uniforms_;
+  }
+  [[nodiscard]] const std::vector<UniformBlock> &Blocks() const {
+    return blocks_;
+  }
+  // Uploads skipped because the value was unchanged, since creation.
+  [[nodiscard]] size_t SkippedUploads() const { return skipped_uploads_; }
+
+private:
+  template <typename Entry>
+  static void SortByHash(std::vector<Entry> &entries) {
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < entries.size(); ++i) {
+      ASSERT(entries[i - 1].hash != entries[i].hash,
+             "Uniform names {} and {} have the same hash", entries[i - 1].name,
+             entries[i].name);
+    }
+  }
+
+  // Binary search, `Entries` is a (const) std::vector of entries.
+  template <typename Entries>
+  static auto FindByHash(Entries &entries, const uint64_t hash)
+      -> decltype(entries.data()) {
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), hash,
+        [](const auto &entry, const uint64_t h) { return entry.hash < h; });
+    return it != entries.end() && it->hash == hash ? &*it : nullptr;
+  }
+
+  std::vector<Uniform> uniforms_;
+  std::vector<UniformBlock> blocks_;
+  size_t skipped_uploads_{0};
+};
+
+} // namespace gib
@@ -1,4 +1,5 @@
 #include "engine/textures/texture.h"
+#include "engine/textures/texture_streamer.h"
 #include "engine/textures/texture_utils.h"
 #include "util/report/report.h"
 
@@ -7,110 +8,137 @@
 
 namespace gib {
 
-Texture Texture::Load2D(const std::string &path, const TextureParams &params,
-                        const bool is_srgb) {
-  Texture texture;
-  texture.type_ = TextureType::TEXTURE_2D;
+namespace {
 
-  stbi_set_flip_vertically_on_load(
-      static_cast<int>(params.flip_vertical_on_load));
-  unsigned char *data = stbi_load(path.c_str(), &texture.size_.x,
-                                  &texture.size_.y, &texture.num_channels_,
-                                  /*desired_channels=*/0);
-  ASSERT(data != nullptr, "Failed to load texture from {}", path);
+void SetMipRangeOf(const GLenum target, const GLuint texture_id,
+                   const int min, const int max) {
+  GLCore::Current().BindTexture(target, texture_id);
+  glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, min);
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, max);
+}
 
-  GLenum data_format = GL_INVALID_ENUM;
-  switch (texture.num_channels_) {
-  case 1:
-    texture.internal_format_ = GL_R8;
-    data_format = GL_RED;
-    break;
-  case 2:
-    texture.internal_format_ = GL_RG8;
-    data_format = GL_RG;
-    break;
-  case 3:
-    texture.internal_format_ = is_srgb ? GL_SRGB8 : GL_RGB8;
-    data_format = GL_RGB;
-    break;
-  case 4:
-    texture.internal_format_ = is_srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
-    data_format = GL_RGBA;
-    break;
-  default:
-    THROW_FATAL("Attempting to load un-supported texture type. {} contains "
-                "unsupported number of channels: {}",
-                path, texture.num_channels_);
+void GenerateMipsOf(const GLenum target, const GLuint texture_id,
+                    const int max_num_mip) {
+  if (max_num_mip >= 0) {
+    SetMipRangeOf(target, texture_id, 0, max_num_mip);
   }
-  glGenTextures(1, &texture.texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture.texture_id_);
 
-  // TODO(rochan): Replace with glTexStorage2D (OpenGL 4.4)
-  glTexImage2D(GL_TEXTURE_2D, /* mipmap level */ 0, texture.internal_format_,
-               texture.size_.x, texture.size_.y, 0,
-               /* tex data format */ data_format, GL_UNSIGNED_BYTE, data);
+  GLCore::Current().BindTexture(target, texture_id);
+  glGenerateMipmap(target);
+
+  if (max_num_mip >= 0) {
+    // OpenGL defaults.
+    SetMipRangeOf(target, texture_id, kMinMip, kMaxMip);
+  }
+}
 
-  if (params.mip_generation == MipGeneration::NEVER) {
-    texture.num_mips_ = 1;
+} // namespace
+
+DecodedImage DecodedImage::Decode(const std::string &path,
+                                  const bool flip_vertical,
+                                  const bool is_hdr) {
+  DecodedImage image;
+  image.is_hdr = is_hdr;
+  // The per-thread flag, decoding may run on several threads at once.
+  stbi_set_flip_vertically_on_load_thread(static_cast<int>(flip_vertical));
+  void *pixels = nullptr;
+  if (is_hdr) {
+    pixels = stbi_loadf(path.c_str(), &image.size.x, &image.size.y,
+                        &image.num_channels, /*desired_channels=*/0);
   } else {
-    texture.num_mips_ = std::min(params.max_num_mip, GetNumMips(texture.size_));
-    texture.GenerateMips(texture.num_mips_);
+    pixels = stbi_load(path.c_str(), &image.size.x, &image.size.y,
+                       &image.num_channels, /*desired_channels=*/0);
   }
-  ApplyTextureParams(params, texture.type_);
-  stbi_image_free(data);
+  if (pixels != nullptr) {
+    image.pixels = {pixels, stbi_image_free};
+  }
+  return image;
+}
+
+Texture Texture::Load2D(const std::string &path, const TextureParams &params,
+                        const bool is_srgb) {
+  const DecodedImage image = DecodedImage::Decode(
+      path, params.flip_vertical_on_load, /*is_hdr=*/false);
+  ASSERT(image.pixels != nullptr, "Failed to load texture from {}", path);
+  Texture texture = FromImage(image, params, is_srgb);
+  texture.path_ = path;
   return texture;
 }
 
 Texture Texture::Load2DHDR(const std::string &path,
                            const TextureParams &params) {
+  const DecodedImage image = DecodedImage::Decode(
+      path, params.flip_vertical_on_load, /*is_hdr=*/true);
+  ASSERT(image.pixels != nullptr, "Failed to load texture from {}", path);
+  Texture texture = FromImage(image, params);
+  texture.path_ = path;
+  return texture;
+}
+
+Texture Texture::FromImage(const DecodedImage &image,
+                           const TextureParams &params, const bool is_srgb) {
   Texture texture;
   texture.type_ = TextureType::TEXTURE_2D;
+  texture.info_->size = image.size;
+  texture.info_->num_channels = image.num_channels;
 
-  stbi_set_flip_vertically_on_load(params.flip_vertical_on_load);
-  float *data = stbi_loadf(path.c_str(), &texture.size_.x, &texture.size_.y,
-                           &texture.num_channels_, /*desired_channels=*/0);
-  ASSERT(data != nullptr, "Failed to load texture from {}", path);
+  glGenTextures(1, &texture.texture_id_);
+  GLCore::Current().BindTexture(GL_TEXTURE_2D, texture.texture_id_);
+  texture.info_->internal_format =
+      UploadImage(GL_TEXTURE_2D, image, image.pixels.get(), is_srgb);
+  texture.info_->num_mips =
+      FinishLevels(texture.texture_id_, texture.info_->size, params);
+  return texture;
+}
 
+GLenum Texture::UploadImage(const GLenum target, const DecodedImage &image,
+                            const void *pixels, const bool is_srgb) {
+  GLenum internal_format = GL_INVALID_ENUM;
   GLenum data_format = GL_INVALID_ENUM;
-  switch (texture.num_channels_) {
+  switch (image.num_channels) {
   case 1:
-    texture.internal_format_ = GL_R16F;
+    internal_format = image.is_hdr ? GL_R16F : GL_R8;
     data_format = GL_RED;
     break;
   case 2:
-    texture.internal_format_ = GL_RG16F;
+    internal_format = image.is_hdr ? GL_RG16F : GL_RG8;
     data_format = GL_RG;
     break;
   case 3:
-    texture.internal_format_ = GL_RGB16F;
+    internal_format = image.is_hdr ? GL_RGB16F
+                      : is_srgb    ? GL_SRGB8
+                                   : GL_RGB8;
     data_format = GL_RGB;
     break;
   case 4:
-    texture.internal_format_ = GL_RGBA16F;
+    internal_format = image.is_hdr ? GL_RGBA16F
+                      : is_srgb    ? GL_SRGB8_ALPHA8
+                                   : GL_RGBA8;
     data_format = GL_RGBA;
     break;
   default:
-    THROW_FATAL("Attempting to load un-supported texture type. {} contains "
+    THROW_FATAL("Attempting to load un-supported texture type. Image contains "
                 "unsupported number of channels: {}",
-                path, texture.num_channels_);
+                image.num_channels);
   }
-  glGenTextures(1, &texture.texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture.texture_id_);
 
-  // TODO(rochan): Replace with glTexStorage2D
-  glTexImage2D(GL_TEXTURE_2D, /*mip=*/0, texture.internal_format_,
-               texture.size_.x, texture.size_.y, 0,
-               /*tex data format=*/data_format, GL_FLOAT, data);
+  // TODO(rochan): Replace with glTexStorage2D (OpenGL 4.4)
+  glTexImage2D(target, /*mip=*/0, internal_format, image.size.Width(),
+               image.size.Height(), 0, /*tex data format=*/data_format,
+               image.is_hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, pixels);
+  return internal_format;
+}
 
-  if (params.mip_generation == MipGeneration::NEVER) {
-    texture.num_mips_ = 1;
-  } else {
-    texture.num_mips_ = std::min(params.max_num_mip, GetNumMips(texture.size_));
-    texture.GenerateMips(texture.num_mips_);
+int Texture::FinishLevels(const GLuint texture_id, const Size2D &size,
+                          const TextureParams &params) {
+  GLCore::Current().BindTexture(GL_TEXTURE_2D, texture_id);
+  int num_mips = 1;
+  if (params.mip_generation != MipGeneration::NEVER) {
+    num_mips = std::min(params.max_num_mip, GetNumMips(size));
+    GenerateMipsOf(GL_TEXTURE_2D, texture_id, num_mips);
   }
-  ApplyTextureParams(params, texture.type_);
-  stbi_image_free(data);
-  return texture;
+  ApplyTextureParams(params, TextureType::TEXTURE_2D);
+  return num_mips;
 }
 
 Texture Texture::LoadCubemap(const std::vector<std::string> &paths,
@@ -121,12 +149,12 @@ Texture Texture::LoadCubemap(const std::vector<std::string> &paths,
   Texture texture;
   texture.type_ = TextureType::CUBE_MAP;
   // TODO(rochan): support mip-map for cubemaps?
-  texture.num_mips_ = 1;
+  texture.info_->num_mips = 1;
   // Cubemaps must be RGB.
-  texture.internal_format_ = GL_RGB8;
+  texture.info_->internal_format = GL_RGB8;
 
   glGenTextures(1, &texture.texture_id_);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, texture.texture_id_);
+  GLCore::Current().BindTexture(GL_TEXTURE_CUBE_MAP, texture.texture_id_);
 
   bool initialized = false;
   for (int face_idx = 0; face_idx < paths.size(); ++face_idx) {
@@ -144,20 +172,21 @@ Texture Texture::LoadCubemap(const std::vector<std::string> &paths,
     ASSERT(face_size.Width() > 0 && face_size.Width() == face_size.Height(),
            "Cubemap texture must be square, got {}.", to_string(face_size));
     if (!initialized) {
-      texture.size_ = face_size;
-      texture.num_channels_ = num_channels;
+      texture.info_->size = face_size;
+      texture.info_->num_channels = num_channels;
       initialized = true;
     }
-    ASSERT(face_size == texture.size_,
+    ASSERT(face_size == texture.info_->size,
            "Cubemap texture {} does not match expected size {}, got {}",
-           paths.at(face_idx), to_string(texture.size_), to_string(face_size));
-    ASSERT(num_channels == texture.num_channels_,
+           paths.at(face_idx), to_string(texture.info_->size),
+           to_string(face_size));
+    ASSERT(num_channels == texture.info_->num_channels,
            "Cubemap texture must be square, got {}.", to_string(face_size));
 
     // Load into the next cube map texture position.
     // TODO(rochan): Replace with glTexStorage2D
     glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face_idx, /*level=*/0,
-                 texture.internal_format_, face_size.Width(),
+                 texture.info_->internal_format, face_size.Width(),
                  face_size.Height(), /*border=*/0,
                  /*format=*/GL_RGB, /*type=*/GL_UNSIGNED_BYTE, data);
     stbi_image_free(data);
@@ -170,23 +199,23 @@ Texture Texture::Create2DTexture(const Size2D &size, TextureFormat format,
                                  const TextureParams &params) {
   Texture texture;
   texture.type_ = TextureType::TEXTURE_2D;
-  texture.size_ = size;
-  texture.num_mips_ = 1;
+  texture.info_->size = size;
+  texture.info_->num_mips = 1;
 
   if (params.mip_generation == MipGeneration::ALWAYS) {
-    texture.num_mips_ = std::min(GetNumMips(size), params.max_num_mip);
+    texture.info_->num_mips = std::min(GetNumMips(size), params.max_num_mip);
   }
-  texture.internal_format_ = static_cast<GLenum>(format);
+  texture.info_->internal_format = static_cast<GLenum>(format);
 
   glGenTextures(1, &texture.texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture.texture_id_);
+  GLCore::Current().BindTexture(GL_TEXTURE_2D, texture.texture_id_);
 
   // TODO(rochan): Replace with glTexStorage2D.
   // Not sure if the format passed here is correct.
   // Ref: https://docs.gl/gl4/glTexImage2D
-  glTexImage2D(GL_TEXTURE_2D, /*mip=*/0, texture.internal_format_,
-               texture.size_.Width(), texture.size_.Height(), 0,
-               /*format=*/texture.internal_format_, GL_FLOAT, nullptr);
+  glTexImage2D(GL_TEXTURE_2D, /*mip=*/0, texture.info_->internal_format,
+               texture.info_->size.Width(), texture.info_->size.Height(), 0,
+               /*format=*/texture.info_->internal_format, GL_FLOAT, nullptr);
   ApplyTextureParams(params, texture.type_);
   return texture;
 }
@@ -195,23 +224,24 @@ Texture Texture::CreateCubemap(const int size, TextureFormat format,
                                const TextureParams &params) {
   Texture texture;
   texture.type_ = TextureType::CUBE_MAP;
-  texture.size_ = Size2D(size, size);
-  texture.num_mips_ = 1;
+  texture.info_->size = Size2D(size, size);
+  texture.info_->num_mips = 1;
 
   if (params.mip_generation == MipGeneration::ALWAYS) {
-    texture.num_mips_ = std::min(GetNumMips(texture.size_), params.max_num_mip);
+    texture.info_->num_mips =
+        std::min(GetNumMips(texture.info_->size), params.max_num_mip);
   }
-  texture.internal_format_ = static_cast<GLenum>(format);
+  texture.info_->internal_format = static_cast<GLenum>(format);
 
   glGenTextures(1, &texture.texture_id_);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, texture.texture_id_);
+  GLCore::Current().BindTexture(GL_TEXTURE_CUBE_MAP, texture.texture_id_);
 
   // TODO(rochan): Replace with glTexStorage2D.
   // Not sure if the format passed here is correct.
   // Ref: https://docs.gl/gl4/glTexImage2D
-  glTexImage2D(GL_TEXTURE_CUBE_MAP, /*mip=*/0, texture.internal_format_,
-               texture.size_.Width(), texture.size_.Height(), 0,
-               /*format=*/texture.internal_format_, GL_FLOAT, nullptr);
+  glTexImage2D(GL_TEXTURE_CUBE_MAP, /*mip=*/0, texture.info_->internal_format,
+               texture.info_->size.Width(), texture.info_->size.Height(), 0,
+               /*format=*/texture.info_->internal_format, GL_FLOAT, nullptr);
   ApplyTextureParams(params, texture.type_);
   return texture;
 }
@@ -224,14 +254,16 @@ Texture Texture::CreateFromData(const Size2D &size, TextureFormat format,
 
   Texture texture = Texture::Create2DTexture(size, format, params);
   glTexSubImage2D(GL_TEXTURE_2D, /*level=*/0, /*xoffset=*/0,
-                  /*yoffset=*/0, texture.size_.Width(), texture.size_.Height(),
+                  /*yoffset=*/0, texture.info_->size.Width(),
+                  texture.info_->size.Height(),
                   /*format=*/GL_RGB, GL_FLOAT, data.data());
   return texture;
 }
 
-void Texture::BindToUnit(unsigned int texture_unit, TextureBindType bind_type) {
+void Texture::BindToUnit(unsigned int texture_unit,
+                         TextureBindType bind_type) const {
   // TODO(rochan): Take into account GL_MAX_TEXTURE_UNITS here.
-  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  GLCore::Current().ActiveTexture(texture_unit);
 
   if (bind_type == TextureBindType::BY_TEXTURE_TYPE) {
     switch (type_) {
@@ -250,10 +282,10 @@ void Texture::BindToUnit(unsigned int texture_unit, TextureBindType bind_type) {
 
   switch (bind_type) {
   case TextureBindType::TEXTURE_2D:
-    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    GLCore::Current().BindTexture(GL_TEXTURE_2D, texture_id_);
     break;
   case TextureBindType::CUBEMAP:
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id_);
+    GLCore::Current().BindTexture(GL_TEXTURE_CUBE_MAP, texture_id_);
     break;
   case TextureBindType::IMAGE_TEXTURE:
     // TODO(rochan): requires OpenGL 4.4 or newer
@@ -269,10 +301,7 @@ void Texture::BindToUnit(unsigned int texture_unit, TextureBindType bind_type) {
 }
 
 void Texture::SetMipRange(const int min, const int max) {
-  const auto target = static_cast<GLenum>(type_);
-  glBindTexture(target, texture_id_);
-  glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, min);
-  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, max);
+  SetMipRangeOf(static_cast<GLenum>(type_), texture_id_, min, max);
 }
 
 void Texture::UnsetMipRange() {
@@ -280,24 +309,35 @@ void Texture::UnsetMipRange() {
   SetMipRange(kMinMip, kMaxMip);
 }
 
+Texture::Texture(Texture &&other) noexcept
+    : texture_id_(std::exchange(other.texture_id_, 0)), type_(other.type_),
+      path_(std::move(other.path_)),
+      info_(std::exchange(other.info_, std::make_shared<TextureInfo>())) {}
+
+Texture &Texture::operator=(Texture &&other) noexcept {
+  if (this != &other) {
+    // Swapped, so the old texture is deleted along with `other`.
+    std::swap(texture_id_, other.texture_id_);
+    std::swap(type_, other.type_);
+    std::swap(path_, other.path_);
+    std::swap(info_, other.info_);
+  }
+  return *this;
+}
+
 Texture::~Texture() {
   if (texture_id_ > 0) {
-    glDeleteTextures(1, &texture_id_);
+    if (TextureStreamer *streamer = TextureStreamer::Current();
+        streamer != nullptr) {
+      // Drops a pending upload, the name may be reused.
+      streamer->Cancel(texture_id_);
+    }
+    GLCore::Current().DeleteTexture(texture_id_);
   }
 }
 
 void Texture::GenerateMips(const int max_num_mip) {
-  if (max_num_mip >= 0) {
-    SetMipRange(0, max_num_mip);
-  }
-
-  const auto target = static_cast<GLenum>(type_);
-  glBindTexture(target, texture_id_);
-  glGenerateMipmap(target);
-
-  if (max_num_mip >= 0) {
-    UnsetMipRange();
-  }
+  GenerateMipsOf(static_cast<GLenum>(type_), texture_id_, max_num_mip);
 }
 
 void Texture::ApplyTextureParams(const TextureParams &params,
@@ -388,4 +428,15 @@ void Texture::ApplyTextureParams(const TextureParams &params,
   }
 }
 
+void TextureRegistry::PushUsageBlock() {
+  last_available_units_.push_back(next_texture_unit_);
+}
+
+void TextureRegistry::PopUsageBlock() {
+  ASSERT(!last_available_units_.empty(),
+         "PopUsageBlock() without matching PushUsageBlock()");
+  next_texture_unit_ = last_available_units_.back();
+  last_available_units_.pop_back();
+}
+
 } // namespace gib
\ No newline at end of file
@@ -5,9 +5,13 @@
 #define GLAD_GL_IMPLEMENTATION
 #include "third_party/glad/glad.h"
 
+#include "engine/core/gl_core.h"
 #include "engine/core/types.h"
 #include "engine/shaders/shader.h"
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "util/report/report.h"
@@ -39,10 +43,46 @@ struct TextureParams {
 
 static constexpr TextureParams kDefault2DTextureParam;
 
+// Pixels of an image file decoded by stb_image. Decoding makes no GL calls,
+// so it may run on any thread.
+struct DecodedImage {
+  // `pixels` is null if `path` could not be decoded.
+  static DecodedImage Decode(const std::string &path, bool flip_vertical,
+                             bool is_hdr);
+
+  [[nodiscard]] size_t Bytes() const {
+    return static_cast<size_t>(size.Width()) * size.Height() * num_channels *
+           (is_hdr ? sizeof(float) : 1);
+  }
+
+  Size2D size{0, 0};
+  int num_channels{0};
+  // 32-bit float channels instead of 8-bit.
+  bool is_hdr{false};
+  std::unique_ptr<void, void (*)(void *)> pixels{nullptr, nullptr};
+};
+
+// Level 0 description of a texture. A streamed texture shares it with the
+// TextureStreamer, which fills it in once the image is uploaded.
+struct TextureInfo {
+  Size2D size{0, 0};
+  int num_channels{0};
+  int num_mips{0};
+  GLenum internal_format{GL_INVALID_ENUM};
+};
+
+// Owns a GL texture, deleted with the Texture. Move-only; share a texture
+// between owners through a pointer.
 class Texture {
 public:
+  Texture() = default;
   ~Texture();
 
+  Texture(Texture &&other) noexcept;
+  Texture &operator=(Texture &&other) noexcept;
+  Texture(const Texture &) = delete;
+  Texture &operator=(const Texture &) = delete;
+
   // Loads a 2D texture from a given path.
   static Texture Load2D(const std::string &path, const TextureParams &params,
                         bool is_srgb = false);
@@ -52,6 +92,10 @@ public:
   static Texture Load2DHDR(const std::string &path,
                            const TextureParams &params);
 
+  // Creates a 2D texture from a decoded image, HDR if the image is.
+  static Texture FromImage(const DecodedImage &image,
+                           const TextureParams &params, bool is_srgb = false);
+
   // Loads a cubemap from a set of 6 textures for the faces. Textures must be
   // passed in the order: right, left, top, bottom, front, and back (i.e., xp,
   // xn, yp, yn, zp, zn)
@@ -74,8 +118,9 @@ public:
   // Binds the texture to the given texture unit.
   // Unit should be a number starting from 0, not the actual texture unit's
   // GLenum.
-  void BindToUnit(unsigned int texture_unit,
-                  TextureBindType bind_type = TextureBindType::BY_TEXTURE_TYPE);
+  void BindToUnit(
+      unsigned int texture_unit,
+      TextureBindType bind_type = TextureBindType::BY_TEXTURE_TYPE) const;
 
   // Generates mipmaps for the current texture. Note that this will not succeed
   // for textures with immutable storage.
@@ -96,21 +141,36 @@ public:
   [[nodiscard]] std::string GetPath() const {
     return !path_.empty() ? path_ : "NA (likely cubemap or generated texture)";
   }
-  [[nodiscard]] Size2D GetSize2D() const { return size_; }
-  [[nodiscard]] int GetNumChannels() const { return num_channels_; }
-  [[nodiscard]] int NumMips() const { return num_mips_; }
+  [[nodiscard]] Size2D GetSize2D() const { return info_->size; }
+  [[nodiscard]] int GetNumChannels() const { return info_->num_channels; }
+  [[nodiscard]] int NumMips() const { return info_->num_mips; }
   // TODO(rochan): Remove GLenum from this API.
-  [[nodiscard]] GLenum GetInternalFormat() const { return internal_format_; }
+  [[nodiscard]] GLenum GetInternalFormat() const {
+    return info_->internal_format;
+  }
 
 private:
+  // Uploads in place of the placeholders it hands out.
+  friend class TextureStreamer;
+
+  // Specifies level 0 of `target`, whose texture must be bound, from
+  // `image`. `pixels` is either image.pixels or an offset into the bound
+  // GL_PIXEL_UNPACK_BUFFER. Returns the internal format.
+  static GLenum UploadImage(GLenum target, const DecodedImage &image,
+                            const void *pixels, bool is_srgb);
+
+  // Generates the mips `params` ask for of the 2D texture `texture_id`,
+  // whose level 0 is `size`, and applies `params`. Returns the number of
+  // mips.
+  static int FinishLevels(GLuint texture_id, const Size2D &size,
+                          const TextureParams &params);
+
   // TODO(rochan): Manage texture lifetimes to support unloading textures.
   unsigned int texture_id_{0};
   TextureType type_{TextureType::TEXTURE_2D};
   std::string path_;
-  Size2D size_{0, 0};
-  int num_channels_{0};
-  int num_mips_{0};
-  GLenum internal_format_{GL_INVALID_ENUM};
+  // Never null, a moved-from texture gets a fresh one.
+  std::shared_ptr<TextureInfo> info_{std::make_shared<TextureInfo>()};
 
   // Applies the given params to the currently-active texture.
   static void ApplyTextureParams(const TextureParams &params, TextureType type);
@@ -129,9 +189,9 @@ public:
 // Thin wrapper around a texture with packed and texture map type properties.
 class TextureMap {
 public:
-  TextureMap(const Texture &texture, const TextureMapType type,
+  TextureMap(Texture texture, const TextureMapType type,
              bool is_packed = false)
-      : texture_(texture), type_(type), is_packed_(is_packed) {}
+      : texture_(std::move(texture)), type_(type), is_packed_(is_packed) {}
 
   Texture &GetTexture() { return texture_; }
   [[nodiscard]] TextureMapType GetType() const { return type_; }
@@ -0,0 +1,285 @@
+#include "engine/textures/texture_streamer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "engine/core/gl_core.h"
+#include "third_party/imgui/imgui.h"
+#include "util/report/report.h"
+
+namespace gib {
+
+TextureStreamer::TextureStreamer(size_t num_workers) {
+  ASSERT(current_ == nullptr, "Only one TextureStreamer may exist at a time");
+  current_ = this;
+  glGenBuffers(1, &pbo_);
+
+  if (num_workers == 0) {
+    // Leave a core to the render thread.
+    num_workers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  }
+  workers_.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers_.emplace_back([this]() { WorkLoop(); });
+  }
+}
+
+TextureStreamer::~TextureStreamer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_ready_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+  GLCore::Current().DeleteBuffer(pbo_);
+  current_ = nullptr;
+}
+
+Texture TextureStreamer::Request2D(const std::string &path,
+                                   const TextureParams &params,
+                                   const bool is_srgb,
+                                   const glm::vec4 &placeholder) {
+  return Enqueue({0, 0, TextureType::TEXTURE_2D, {path}, params, is_srgb,
+                  /*is_hdr=*/false, nullptr},
+                 placeholder);
+}
+
+Texture TextureStreamer::Request2DHDR(const std::string &path,
+                                      const TextureParams &params,
+                                      const glm::vec4 &placeholder) {
+  return Enqueue({0, 0, TextureType::TEXTURE_2D, {path}, params,
+                  /*is_srgb=*/false, /*is_hdr=*/true, nullptr},
+                 placeholder);
+}
+
+Texture TextureStreamer::RequestCubemap(const std::vector<std::string> &paths,
+                                        const TextureParams &params,
+                                        const glm::vec4 &placeholder) {
+  ASSERT(paths.size() == 6,
+         "Must pass exactly 6 faces to TextureStreamer::RequestCubemap");
+  return Enqueue({0, 0, TextureType::CUBE_MAP, paths, params,
+                  /*is_srgb=*/false, /*is_hdr=*/false, nullptr},
+                 placeholder);
+}
+
+Texture TextureStreamer::Enqueue(Request request,
+                                 const glm::vec4 &placeholder) {
+  Texture texture;
+  texture.type_ = request.type;
+  texture.info_->size = Size2D(1, 1);
+  texture.info_->num_channels = 4;
+  texture.info_->num_mips = 1;
+  texture.info_->internal_format = GL_RGBA8;
+  if (request.type == TextureType::TEXTURE_2D) {
+    texture.path_ = request.paths.front();
+  }
+
+  const auto target = static_cast<GLenum>(request.type);
+  glGenTextures(1, &texture.texture_id_);
+  GLCore::Current().BindTexture(target, texture.texture_id_);
+  const glm::vec4 clamped = glm::clamp(placeholder, 0.f, 1.f);
+  const unsigned char texel[4] = {
+      static_cast<unsigned char>(clamped.r * 255.f + 0.5f),
+      static_cast<unsigned char>(clamped.g * 255.f + 0.5f),
+      static_cast<unsigned char>(clamped.b * 255.f + 0.5f),
+      static_cast<unsigned char>(clamped.a * 255.f + 0.5f)};
+  const int num_faces = request.type == TextureType::CUBE_MAP ? 6 : 1;
+  for (int face = 0; face < num_faces; ++face) {
+    const GLenum face_target = request.type == TextureType::CUBE_MAP
+                                   ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face
+                                   : GL_TEXTURE_2D;
+    glTexImage2D(face_target, /*level=*/0, GL_RGBA8, 1, 1, /*border=*/0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, texel);
+  }
+  Texture::ApplyTextureParams(request.params, request.type);
+  // A single level until the image arrives, so mipmapped filtering of the
+  // placeholder is complete.
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+
+  request.texture_id = texture.texture_id_;
+  request.serial = next_serial_++;
+  request.info = texture.info_;
+  pending_[request.texture_id] = request.serial;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back(std::move(request));
+  }
+  work_ready_.notify_one();
+  return texture;
+}
+
+void TextureStreamer::Update(const time_util::DurationUsec budget) {
+  PROFILE_SCOPE_N("TextureStreamer::Update");
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Decoded &decoded : decoded_) {
+      ready_.push_back(std::move(decoded));
+    }
+    decoded_.clear();
+  }
+
+  const time_util::TimePoint start = time_util::now();
+  size_t uploaded = 0;
+  while (!ready_.empty() &&
+         (uploaded == 0 || time_util::elapsed_usec(start) < budget)) {
+    const size_t bytes = Upload(ready_.front());
+    ready_.pop_front();
+    if (bytes > 0) {
+      ++uploaded;
+      ++uploads_;
+      uploaded_bytes_ += bytes;
+    }
+  }
+}
+
+void TextureStreamer::Cancel(const GLuint texture_id) {
+  pending_.erase(texture_id);
+}
+
+void TextureStreamer::DebugUI() {
+  if (ImGui::CollapsingHeader("Texture Streaming")) {
+    size_t queued = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued = requests_.size();
+    }
+    ImGui::Text("Workers: %zu", workers_.size());
+    ImGui::Text("Pending: %zu (%zu decoding, %zu waiting for upload)",
+                pending_.size(), queued, ready_.size());
+    ImGui::Text("Uploaded: %zu, %.1f MiB", uploads_,
+                static_cast<float>(uploaded_bytes_) / (1024.f * 1024.f));
+    ImGui::Text("Failed: %zu", failures_);
+  }
+}
+
+void TextureStreamer::WorkLoop() {
+  while (true) {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_ready_.wait(lock,
+                       [this]() { return stop_ || !requests_.empty(); });
+      if (stop_) {
+        return;
+      }
+      request = std::move(requests_.front());
+      requests_.pop_front();
+    }
+    Decoded decoded = Decode(std::move(request));
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded_.push_back(std::move(decoded));
+  }
+}
+
+TextureStreamer::Decoded TextureStreamer::Decode(Request request) {
+  Decoded decoded{std::move(request), {}, ""};
+  const Request &req = decoded.request;
+  for (const std::string &path : req.paths) {
+    DecodedImage image = DecodedImage::Decode(
+        path, req.params.flip_vertical_on_load, req.is_hdr);
+    if (image.pixels == nullptr) {
+      decoded.error = fmt::format("Failed to load texture from {}", path);
+      decoded.images.clear();
+      return decoded;
+    }
+    decoded.images.push_back(std::move(image));
+  }
+  if (req.type != TextureType::CUBE_MAP) {
+    return decoded;
+  }
+  // Same checks as Texture::LoadCubemap().
+  const DecodedImage &first = decoded.images.front();
+  for (size_t face = 0; face < decoded.images.size(); ++face) {
+    const DecodedImage &image = decoded.images[face];
+    if (image.num_channels != 3 || image.size.Width() <= 0 ||
+        image.size.Width() != image.size.Height() ||
+        image.size != first.size) {
+      decoded.error = fmt::format(
+          "Cubemap face {} must be RGB, square and match the first face, "
+          "got {} channels, {}",
+          req.paths[face], image.num_channels, to_string(image.size));
+      decoded.images.clear();
+      return decoded;
+    }
+  }
+  return decoded;
+}
+
+size_t TextureStreamer::Upload(const Decoded &decoded) {
+  const Request &request = decoded.request;
+  const auto pending = pending_.find(request.texture_id);
+  if (pending == pending_.end() || pending->second != request.serial) {
+    // Cancelled, the texture was deleted.
+    return 0;
+  }
+  pending_.erase(pending);
+  if (decoded.images.empty()) {
+    WARNING("{}, keeping the placeholder", decoded.error);
+    ++failures_;
+    return 0;
+  }
+
+  GLCore &gl_core = GLCore::Current();
+  const auto target = static_cast<GLenum>(request.type);
+  gl_core.BindTexture(target, request.texture_id);
+  // OpenGL default, undoes the placeholder's single level.
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, kMaxMip);
+
+  size_t bytes = 0;
+  GLenum internal_format = GL_INVALID_ENUM;
+  gl_core.BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+  for (size_t face = 0; face < decoded.images.size(); ++face) {
+    const GLenum face_target =
+        request.type == TextureType::CUBE_MAP
+            ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(face)
+            : GL_TEXTURE_2D;
+    internal_format =
+        UploadLevel(face_target, decoded.images[face], request.is_srgb);
+    bytes += decoded.images[face].Bytes();
+  }
+  // Unbound, later glTexImage2D calls pass client memory.
+  gl_core.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  const DecodedImage &first = decoded.images.front();
+  TextureInfo &info = *request.info;
+  info.size = first.size;
+  info.num_channels = first.num_channels;
+  info.internal_format = internal_format;
+  if (request.type == TextureType::CUBE_MAP) {
+    // Like Texture::LoadCubemap(), without mips.
+    Texture::ApplyTextureParams(request.params, request.type);
+    info.num_mips = 1;
+  } else {
+    info.num_mips =
+        Texture::FinishLevels(request.texture_id, first.size, request.params);
+  }
+  return bytes;
+}
+
+GLenum TextureStreamer::UploadLevel(const GLenum target,
+                                    const DecodedImage &image,
+                                    const bool is_srgb) {
+  const auto bytes = static_cast<GLsizeiptr>(image.Bytes());
+  // Orphaned, so mapping never waits for the previous upload to be read.
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+  void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                  GL_MAP_WRITE_BIT |
+                                      GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (mapped == nullptr) {
+    WARNING("Failed to map the texture upload buffer, uploading directly");
+    GLCore::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    const GLenum internal_format =
+        Texture::UploadImage(target, image, image.pixels.get(), is_srgb);
+    GLCore::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+    return internal_format;
+  }
+  std::memcpy(mapped, image.pixels.get(), image.Bytes());
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  // A null pointer is offset 0 into the bound pixel unpack buffer, the
+  // driver copies from it without stalling this thread.
+  return Texture::UploadImage(target, image, nullptr, is_srgb);
+}
+
+} // namespace gib
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#define GLAD_GL_IMPLEMENTATION
+#include "third_party/glad/glad.h"
+
+#include "engine/textures/texture.h"
+#include "util/macros.h"
+#include "util/time/time.h"
+
+namespace gib {
+
+// Loads textures without stalling the render thread. Request*() returns a
+// texture at once, showing a one texel placeholder. Worker threads decode the
+// image files, and Update() uploads the decoded images into the same texture
+// object through a pixel unpack buffer, within a per-frame time budget.
+// The returned Texture's size, channels, mips and format describe the
+// placeholder until then, and the image after.
+//
+// Owned by the WindowBase, which calls Update() once per frame. Code that can
+// stream textures reaches it through Current(). Everything but the workers
+// runs on the thread owning the GL context.
+class TextureStreamer {
+public:
+  // Placeholder of textures that are not uploaded yet.
+  static constexpr glm::vec4 kPlaceholderColor{0.5f, 0.5f, 0.5f, 1.f};
+
+  // `num_workers` 0 uses every core but the render thread's.
+  explicit TextureStreamer(size_t num_workers = 0);
+  ~TextureStreamer();
+
+  // The streamer, or nullptr outside the window's lifetime.
+  [[nodiscard]] static TextureStreamer *Current() { return current_; }
+
+  // Streaming versions of Texture::Load2D(), Load2DHDR() and LoadCubemap().
+  // A file that fails to decode keeps the placeholder.
+  Texture Request2D(const std::string &path, const TextureParams &params,
+                    bool is_srgb = false,
+                    const glm::vec4 &placeholder = kPlaceholderColor);
+  Texture Request2DHDR(const std::string &path, const TextureParams &params,
+                       const glm::vec4 &placeholder = kPlaceholderColor);
+  Texture RequestCubemap(const std::vector<std::string> &paths,
+                         const TextureParams &params,
+                         const glm::vec4 &placeholder = kPlaceholderColor);
+
+  // Uploads decoded images until `budget` is spent, at least one per call.
+  // Called once per frame by the window.
+  void Update(time_util::DurationUsec budget = time_util::DurationUsec(2000));
+
+  // Drops the pending upload of `texture_id`, called when a texture is
+  // deleted.
+  void Cancel(GLuint texture_id);
+
+  // True if `texture` holds its image rather than the placeholder.
+  [[nodiscard]] bool IsResident(const Texture &texture) const {
+    return pending_.count(texture.GetTextureId()) == 0;
+  }
+
+  // Requests not uploaded yet.
+  [[nodiscard]] size_t Pending() const { return pending_.size(); }
+
+  void DebugUI();
+
+  DISALLOW_COPY_AND_ASSIGN(TextureStreamer);
+
+private:
+  struct Request {
+    GLuint texture_id;
+    // Tells a request apart from an older one for a reused texture name.
+    uint64_t serial;
+    TextureType type;
+    std::vector<std::string> paths;
+    TextureParams params;
+    bool is_srgb;
+    bool is_hdr;
+    // Of the returned Texture, updated on upload.
+    std::shared_ptr<TextureInfo> info;
+  };
+
+  struct Decoded {
+    Request request;
+    // One per path, empty if any failed to decode.
+    std::vector<DecodedImage> images;
+    // Set if `images` is empty.
+    std::string error;
+  };
+
+  Texture Enqueue(Request request, const glm::vec4 &placeholder);
+
+  // Worker threads.
+  void WorkLoop();
+  static Decoded Decode(Request request);
+
+  // Uploads into the texture through `pbo_`. Returns the bytes uploaded.
+  size_t Upload(const Decoded &decoded);
+  // Copies `image` into `pbo_` and specifies level 0 of `target` from it.
+  // Returns the internal format.
+  GLenum UploadLevel(GLenum target, const DecodedImage &image, bool is_srgb);
+
+  static inline TextureStreamer *current_ = nullptr;
+
+  // Plain threads rather than @lock_free_work_pool: that module is a
+  // dev_dependency in MODULE.bazel, which Bazel drops when dm-gib is not the
+  // root module, so this library cannot depend on it. Each task decodes a
+  // whole image, so queue contention does not matter here.
+  std::vector<std::thread> workers_;
+
+  // Guards the members up to `decoded_`, shared with the workers.
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  bool stop_{false};
+  std::deque<Request> requests_;
+  std::vector<Decoded> decoded_;
+
+  // Render thread only.
+  // Serial of the pending request of each texture.
+  std::unordered_map<GLuint, uint64_t> pending_;
+  uint64_t next_serial_{0};
+  // Decoded, waiting for upload budget.
+  std::deque<Decoded> ready_;
+  GLuint pbo_{0};
+
+  // Totals since creation.
+  size_t uploads_{0};
+  size_t uploaded_bytes_{0};
+  size_t failures_{0};
+};
+
+} // namespace gib
@@ -155,6 +155,8 @@ inline std::string TextureMapTypeToString(const TextureMapType type) {
     return "u_Emmision";
   case TextureMapType::NORMAL:
     return "u_Normal";
+  case TextureMapType::CUBEMAP:
+    return "u_Cubemap";
   default:
     THROW_FATAL("ERROR::TEXTURE_MAP::INVALID_TEXTURE_MAP_TYPE {}",
                 static_cast<int>(type));
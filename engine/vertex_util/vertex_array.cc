@@ -9,14 +9,18 @@ VertexArray::VertexArray() {
 }
 
 VertexArray::~VertexArray() {
+  GLCore &gl_core = GLCore::Current();
+  if (instance_vbo_ != 0u) {
+    gl_core.DeleteBuffer(instance_vbo_);
+  }
   if (ebo_ != 0u) {
-    glDeleteBuffers(1, &ebo_);
+    gl_core.DeleteBuffer(ebo_);
   }
   if (vbo_ != 0u) {
-    glDeleteBuffers(1, &vbo_);
+    gl_core.DeleteBuffer(vbo_);
   }
   if (vao_ != 0u) {
-    glDeleteVertexArrays(1, &vao_);
+    gl_core.DeleteVertexArray(vao_);
   }
 }
 
@@ -26,7 +30,7 @@ void VertexArray::SetVertexData(const void *data, const std::size_t size,
          "Index data ({}) and size ({}) must be non-null & non-zero!", data,
          size);
   Bind();
-  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  GLCore::Current().BindBuffer(GL_ARRAY_BUFFER, vbo_);
   glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), data, usage);
 }
 
@@ -36,7 +40,7 @@ void VertexArray::SetElementData(const void *data, const std::size_t size,
          "Index data ({}) and size ({}) must be non-null & non-zero!", data,
          size);
   Bind();
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+  GLCore::Current().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), data,
                usage);
 }
@@ -44,14 +48,61 @@ void VertexArray::SetElementData(const void *data, const std::size_t size,
 void VertexArray::SetLayout(const VertexLayout &layout) const {
   ASSERT(layout.stride, "Layout stride must be set");
   Bind();
-  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  GLCore::Current().BindBuffer(GL_ARRAY_BUFFER, vbo_);
+
+  for (const auto &element : layout.elements) {
+    EnableAttribute(element, layout.stride);
+  }
+}
+
+void VertexArray::SetInstanceData(const void *data, const std::size_t size,
+                                  const GLenum usage) {
+  ASSERT(data && size,
+         "Instance data ({}) and size ({}) must be non-null & non-zero!", data,
+         size);
+  if (instance_vbo_ == 0u) {
+    glGenBuffers(1, &instance_vbo_);
+  }
+  GLCore::Current().BindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+  if (size > instance_capacity_) {
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), data, usage);
+    instance_capacity_ = size;
+    return;
+  }
+  // Orphan the old storage so the driver does not wait for draws still
+  // reading it.
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instance_capacity_),
+               nullptr, usage);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+}
+
+void VertexArray::SetInstanceLayout(const VertexLayout &layout) {
+  ASSERT(layout.stride, "Layout stride must be set");
+  if (instance_vbo_ == 0u) {
+    glGenBuffers(1, &instance_vbo_);
+  }
+  Bind();
+  GLCore::Current().BindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
 
+  const GLuint divisor = layout.divisor == 0 ? 1 : layout.divisor;
   for (const auto &element : layout.elements) {
-    glEnableVertexAttribArray(element.location);
+    EnableAttribute(element, layout.stride);
+    glVertexAttribDivisor(element.location, divisor);
+  }
+  has_instance_layout_ = true;
+}
+
+void VertexArray::EnableAttribute(const VertexElement &element,
+                                  const std::size_t stride) {
+  glEnableVertexAttribArray(element.location);
+  const auto *offset = reinterpret_cast<const void *>(element.offset);
+  if (element.integer) {
+    glVertexAttribIPointer(element.location, element.components, element.type,
+                           static_cast<GLsizei>(stride), offset);
+  } else {
     glVertexAttribPointer(element.location, element.components, element.type,
-                          element.normalized,
-                          static_cast<GLsizei>(layout.stride),
-                          reinterpret_cast<const void *>(element.offset));
+                          element.normalized, static_cast<GLsizei>(stride),
+                          offset);
   }
 }
 
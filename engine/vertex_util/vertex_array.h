@@ -6,6 +6,7 @@
 #define GLAD_GL_IMPLEMENTATION
 #include "third_party/glad/glad.h"
 
+#include "engine/core/gl_core.h"
 #include "engine/vertex_util/types.h"
 #include "engine/vertex_util/vertex_layout.h"
 #include "util/report/report.h"
@@ -28,19 +29,37 @@ public:
   // Bind a ready-made layout to this VAO
   void SetLayout(const VertexLayout &layout) const;
 
-  void Bind() const { glBindVertexArray(vao_); }
-  static void Unbind() { glBindVertexArray(0); }
+  // Set per-instance data, sourced by the instance layout. The instance
+  // buffer is orphaned and refilled, so it can be updated every frame.
+  void SetInstanceData(const void *data, std::size_t size,
+                       GLenum usage = GL_STREAM_DRAW);
+
+  // Bind a per-instance layout, read from the instance buffer. A layout
+  // divisor of 0 is treated as 1.
+  void SetInstanceLayout(const VertexLayout &layout);
+  [[nodiscard]] bool HasInstanceLayout() const { return has_instance_layout_; }
+
+  void Bind() const { GLCore::Current().BindVertexArray(vao_); }
+  static void Unbind() { GLCore::Current().BindVertexArray(0); }
 
   [[nodiscard]] GLuint GetVao() const { return vao_; }
   [[nodiscard]] GLuint GetVbo() const { return vbo_; }
   [[nodiscard]] GLuint GetEbo() const { return ebo_; }
+  [[nodiscard]] GLuint GetInstanceVbo() const { return instance_vbo_; }
 
   DISALLOW_COPY_AND_ASSIGN(VertexArray);
 
 private:
+  // Enables and points `element` at the bound GL_ARRAY_BUFFER.
+  static void EnableAttribute(const VertexElement &element, std::size_t stride);
+
   GLuint vao_{0};
   GLuint vbo_{0};
   GLuint ebo_{0};
+  // Per-instance attributes, created on first use.
+  GLuint instance_vbo_{0};
+  std::size_t instance_capacity_{0};
+  bool has_instance_layout_{false};
 };
 
 } // namespace gib
\ No newline at end of file
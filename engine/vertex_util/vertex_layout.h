@@ -15,12 +15,16 @@ struct VertexElement {
   GLboolean normalized;
   // Bytes from vertex start
   std::size_t offset;
+  // Integer attribute read as int/uint in the shader (glVertexAttribIPointer).
+  bool integer = false;
 };
 
 // Describes vertex layout as a collection of VertexElements.
 struct VertexLayout {
   std::vector<VertexElement> elements;
   std::size_t stride = 0;
+  // Number of instances drawn per attribute advance, 0 for per-vertex data.
+  GLuint divisor = 0;
 };
 
 } // namespace gib
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "engine/core/gl_core.h"
 #include "engine/core/gl_window.h"
 #include "engine/core/input.h"
+#include "engine/core/simulation_loop.h"
 #include "util/imgui/imgui_util.h"
 #include "util/imgui/imgui_window.h"
 #include "util/macros.h"
@@ -9,25 +10,25 @@
 
 namespace gib {
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::ToggleMouseCapture(
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ToggleMouseCapture(
     const bool &enable_mouse_capture) {
   if (ctx_.enable_mouse_capture == enable_mouse_capture) {
     return;
   }
-  if (enable_mouse_capture) {
+  // Replays only change the capture state, the OS cursor stays with the user.
+  if (input_replayer_ == nullptr) {
     glfwSetInputMode(gl_window_.GetGlfwWindowPtr(), GLFW_CURSOR,
-                     GLFW_CURSOR_DISABLED);
-  } else {
-    glfwSetInputMode(gl_window_.GetGlfwWindowPtr(), GLFW_CURSOR,
-                     GLFW_CURSOR_NORMAL);
+                     enable_mouse_capture ? GLFW_CURSOR_DISABLED
+                                          : GLFW_CURSOR_NORMAL);
   }
   ctx_.enable_mouse_capture = enable_mouse_capture;
   DEBUG("Mouse capture enabled: {}", ctx_.enable_mouse_capture);
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::ToggleKeyInput(const bool &enable_key_input) {
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ToggleKeyInput(
+    const bool &enable_key_input) {
   if (ctx_.enable_key_input == enable_key_input) {
     return;
   }
@@ -55,8 +56,8 @@ void WindowBase<WindowImpl>::ToggleKeyInput(const bool &enable_key_input) {
   DEBUG("Window key input enabled {}", ctx_.enable_key_input);
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::ToggleScrollInput(
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ToggleScrollInput(
     const bool &enable_scroll_input) {
   if (ctx_.enable_scroll_input == enable_scroll_input) {
     return;
@@ -81,8 +82,8 @@ void WindowBase<WindowImpl>::ToggleScrollInput(
   DEBUG("Window scroll input enabled {}", enable_scroll_input);
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::ToggleMouseMoveInput(
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ToggleMouseMoveInput(
     const bool &enable_mouse_move_input) {
   if (ctx_.enable_mouse_move_input == enable_mouse_move_input) {
     return;
@@ -107,8 +108,8 @@ void WindowBase<WindowImpl>::ToggleMouseMoveInput(
   DEBUG("Window mouse move input enabled: {}", enable_mouse_move_input);
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::ToggleMouseButtonInput(
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ToggleMouseButtonInput(
     const bool &enable_mouse_button_input) {
   if (ctx_.enable_mouse_button_input == enable_mouse_button_input) {
     return;
@@ -133,74 +134,209 @@ void WindowBase<WindowImpl>::ToggleMouseButtonInput(
   DEBUG("Window mouse button input enabled {}", enable_mouse_button_input);
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::KeyCallback(int key, int scancode, int action,
-                                         int mods) {
-  if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-    if (esc_behavior_ == EscBehavior::TOGGLE_MOUSE_CAPTURE) {
-      ToggleMouseCapture(!ctx_.enable_mouse_capture);
-    } else if (esc_behavior_ == EscBehavior::CLOSE) {
-      glfwSetWindowShouldClose(gl_window_.GetGlfwWindowPtr(), true);
-    } else if (esc_behavior_ == EscBehavior::UNCAPTURE_MOUSE_OR_CLOSE) {
-      auto inputMode =
-          glfwGetInputMode(gl_window_.GetGlfwWindowPtr(), GLFW_CURSOR);
-      if (inputMode == GLFW_CURSOR_DISABLED) {
-        ToggleMouseCapture(false);
-      } else {
-        // Close since mouse is not captured.
-        glfwSetWindowShouldClose(gl_window_.GetGlfwWindowPtr(), true);
-      }
-    }
-  }
-  input_.KeyCallback(key, scancode, action, mods);
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::KeyCallback(int key, int scancode,
+                                                   int action, int mods) {
+  InputEvent event{};
+  event.time = time_util::now();
+  event.type = InputEventType::KEY;
+  event.code = key;
+  event.scancode = scancode;
+  event.action = action;
+  event.mods = mods;
+  QueueInputEvent(event);
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ScrollCallback(double xoffset,
+                                                      double yoffset) {
+  InputEvent event{};
+  event.time = time_util::now();
+  event.type = InputEventType::SCROLL;
+  event.value = {static_cast<float>(xoffset), static_cast<float>(yoffset)};
+  QueueInputEvent(event);
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::ScrollCallback(double xoffset, double yoffset) {
-  input_.ScrollCallback(xoffset, yoffset);
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::MouseMoveCallback(double xpos,
+                                                         double ypos) {
+  InputEvent event{};
+  event.time = time_util::now();
+  event.type = InputEventType::MOUSE_MOVE;
+  event.value = {static_cast<float>(xpos), static_cast<float>(ypos)};
+  QueueInputEvent(event);
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::MouseMoveCallback(double xpos, double ypos) {
-  input_.MouseMoveCallback(xpos, ypos);
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::MouseButtonCallback(int button,
+                                                           int action,
+                                                           int mods) {
+  InputEvent event{};
+  event.time = time_util::now();
+  event.type = InputEventType::MOUSE_BUTTON;
+  event.code = button;
+  event.action = action;
+  event.mods = mods;
+  QueueInputEvent(event);
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::QueueInputEvent(
+    const InputEvent &event) {
+  if (input_replayer_ != nullptr) {
+    return;
+  }
+  ApplyInputEvent(event);
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ApplyInputEvent(
+    const InputEvent &event) {
+  HandleCaptureInput(event);
+  // The render thread sees every event of the frame, the simulation thread
+  // (if any) receives them with their timestamps to place them in the right
+  // tick.
+  input_.Apply(event);
+  if (simulation_ != nullptr) {
+    simulation_->PushInputEvent(event);
+  }
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::MouseButtonCallback(int button, int action,
-                                                 int mods) {
-  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-    if (mouse_button_behavior_ == MouseButtonBehavior::CAPTURE) {
-      ToggleMouseCapture(true);
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::HandleCaptureInput(
+    const InputEvent &event) {
+  if (event.action != GLFW_PRESS) {
+    return;
+  }
+  if (event.type == InputEventType::MOUSE_BUTTON &&
+      event.code == GLFW_MOUSE_BUTTON_LEFT &&
+      mouse_button_behavior_ == MouseButtonBehavior::CAPTURE) {
+    ToggleMouseCapture(true);
+    return;
+  }
+  if (event.type != InputEventType::KEY || event.code != GLFW_KEY_ESCAPE) {
+    return;
+  }
+  // Decided by the capture state rather than the OS cursor, which replays do
+  // not touch.
+  bool close = false;
+  if (esc_behavior_ == EscBehavior::TOGGLE_MOUSE_CAPTURE) {
+    ToggleMouseCapture(!ctx_.enable_mouse_capture);
+  } else if (esc_behavior_ == EscBehavior::CLOSE) {
+    close = true;
+  } else if (esc_behavior_ == EscBehavior::UNCAPTURE_MOUSE_OR_CLOSE) {
+    if (ctx_.enable_mouse_capture) {
+      ToggleMouseCapture(false);
+    } else {
+      // Close since mouse is not captured.
+      close = true;
     }
   }
-  input_.MouseButtonCallback(button, action, mods);
+  // A replay ends with its recording instead.
+  if (close && input_replayer_ == nullptr) {
+    glfwSetWindowShouldClose(gl_window_.GetGlfwWindowPtr(), true);
+  }
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::SetEscKeyBehavior(const EscBehavior esc_behavior) {
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::SetEscKeyBehavior(
+    const EscBehavior esc_behavior) {
   esc_behavior_ = esc_behavior;
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::SetMouseButtonBehavior(
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::SetMouseButtonBehavior(
     const MouseButtonBehavior mouse_button_behavior) {
   mouse_button_behavior_ = mouse_button_behavior;
 }
 
-template <typename WindowImpl>
-void WindowBase<WindowImpl>::SetGLFWInputMode(const int mode, const int value) {
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::SetGLFWInputMode(const int mode,
+                                                        const int value) {
   glfwSetInputMode(gl_window_.GetGlfwWindowPtr(), mode, value);
   DEBUG("Set GLFW InputMode to mode: {}, value: {}", mode, value);
 }
 
-template <typename WindowImpl> void WindowBase<WindowImpl>::Run() {
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::RecordInput(const std::string &path) {
+  record_input_path_ = path;
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::ReplayInput(
+    const std::string &path,
+    const std::optional<time_util::DurationUsec> fixed_dt) {
+  replay_input_path_ = path;
+  replay_fixed_dt_ = fixed_dt;
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::Run() {
   bool enable_imgui = true;
   last_time_ = time_util::now();
 
+  if (!record_input_path_.empty()) {
+    input_recorder_ =
+        std::make_unique<InputRecorder>(record_input_path_, last_time_);
+  }
+  if (!replay_input_path_.empty()) {
+    input_replayer_ = std::make_unique<InputReplayer>(
+        replay_input_path_, last_time_, replay_fixed_dt_);
+  }
+  std::vector<InputEvent> replay_events;
+  if constexpr (kHasSimulation) {
+    if (simulation_ != nullptr) {
+      // While replaying, simulation ticks follow the replay clock instead of
+      // the wall clock, so every run applies the same events to the same
+      // ticks.
+      simulation_->Start(
+          [this](const FrameTick &tick, const Input &input, SimState &state) {
+            static_cast<WindowImpl *>(this)->SimTick(tick, input, state);
+          },
+          sim_state_,
+          input_replayer_ != nullptr
+              ? std::optional<time_util::TimePoint>(last_time_)
+              : std::nullopt);
+    }
+  }
+
+  FramePacer &frame_pacer = gl_window_.GetFramePacer();
+
   while (!glfwWindowShouldClose(gl_window_.GetGlfwWindowPtr())) {
-    const FrameTick tick{time_util::now(), time_util::elapsed_usec(last_time_)};
-    last_time_ = tick.current_time;
+    // In low latency mode this sleeps until just before the frame deadline so
+    // input is sampled as late as possible.
+    frame_pacer.BeginFrame();
+    // Wall clock tick, used for frame timing stats.
+    const FrameTick frame_tick{time_util::now(),
+                               time_util::elapsed_usec(last_time_)};
+    last_time_ = frame_tick.current_time;
+    const std::optional<FrameTick> replay_tick =
+        input_replayer_ != nullptr ? input_replayer_->NextFrame(replay_events)
+                                   : std::nullopt;
+    if (input_replayer_ != nullptr && !replay_tick.has_value()) {
+      INFO("Input replay finished after {} frames",
+           input_replayer_->FrameCount());
+      break;
+    }
+    // Tick seen by WindowImpl.
+    const FrameTick tick = replay_tick.value_or(frame_tick);
+
     glfwPollEvents();
+    for (const InputEvent &event : replay_events) {
+      ApplyInputEvent(event);
+    }
+    if (simulation_ != nullptr && input_replayer_ != nullptr) {
+      // Lockstep: simulate up to this frame before drawing it.
+      simulation_->RunUntil(tick.current_time);
+    }
+    frame_pacer.MarkInputSampled();
+    GpuProfiler::Get().BeginFrame();
+    if (input_recorder_ != nullptr) {
+      input_recorder_->RecordFrame(tick, input_.events);
+    }
+
+    // Textures decoded since the last frame are drawn from this frame on.
+    texture_streamer_.Update();
 
     glClearColor(clear_color_.r, clear_color_.g, clear_color_.b,
                  clear_color_.a);
@@ -213,21 +349,84 @@ template <typename WindowImpl> void WindowBase<WindowImpl>::Run() {
     }
     glClear(clear_bits);
 
-    gl_window_.Tick(tick);
-    static_cast<WindowImpl *>(this)->Tick(tick, gl_window_);
+    gl_window_.Tick(frame_tick);
+    {
+      PROFILE_GPU_SCOPE_N("Scene");
+      TickImpl(tick);
+    }
     if (enable_imgui) {
+      PROFILE_GPU_SCOPE_N("ImGui");
       DebugUI();
     }
 
     CHECK_GL_ERROR();
-    glfwSwapBuffers(gl_window_.GetGlfwWindowPtr());
+    GpuProfiler::Get().EndFrame();
+    frame_pacer.EndFrame();
+    // Keep the driver from queueing more than max frames in flight.
+    frame_pacer.LimitFramesInFlight();
+    gl_window_.SwapBuffers();
+    frame_pacer.MarkPresented();
 
     static_cast<WindowImpl *>(this)->Tock(tick, gl_window_);
     input_.Reset();
   }
+
+  if (simulation_ != nullptr) {
+    simulation_->Stop();
+  }
 }
 
-template <typename WindowImpl> void WindowBase<WindowImpl>::DebugUI() {
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::EnableSimulationThread(
+    const float rate_hz, const SimState &initial_state) {
+  static_assert(kHasSimulation,
+                "EnableSimulationThread() requires a SimState type");
+  ASSERT(simulation_ == nullptr, "Simulation thread already enabled");
+  simulation_ = std::make_unique<SimulationLoop<SimState>>(rate_hz);
+  // Seeds the simulation thread once Run() starts it.
+  sim_state_ = initial_state;
+  render_delay_ = std::max(render_delay_, simulation_->TickDt());
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::SetRenderDelay(
+    const time_util::DurationUsec render_delay) {
+  if (simulation_ != nullptr && render_delay < simulation_->TickDt()) {
+    WARNING("Render delay {} us is below one simulation tick, interpolation "
+            "will clamp to the newest snapshot",
+            render_delay.count());
+  }
+  render_delay_ = render_delay;
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::TickImpl(const FrameTick &tick) {
+  auto *impl = static_cast<WindowImpl *>(this);
+  if constexpr (!kHasSimulation) {
+    impl->Tick(tick, gl_window_);
+  } else if (simulation_ != nullptr) {
+    // Simulation runs on its own thread, draw the newest snapshot or the one
+    // interpolated at `now - render_delay_`.
+    const auto &snapshots = simulation_->UpdateSnapshots();
+    if constexpr (kIsInterpolatable<SimState>) {
+      std::optional<SimState> state =
+          snapshots.InterpolateAt(tick.current_time - render_delay_);
+      if (state.has_value()) {
+        render_state_ = std::move(*state);
+      }
+      impl->Tick(tick, gl_window_, render_state_);
+    } else {
+      impl->Tick(tick, gl_window_, snapshots.Newest().data);
+    }
+  } else {
+    // Single-threaded mode, simulate with the frame dt.
+    impl->SimTick(tick, input_, sim_state_);
+    impl->Tick(tick, gl_window_, sim_state_);
+  }
+}
+
+template <typename WindowImpl, typename SimState>
+void WindowBase<WindowImpl, SimState>::DebugUI() {
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -235,6 +434,16 @@ template <typename WindowImpl> void WindowBase<WindowImpl>::DebugUI() {
   // Engine‑level widgets
   if (ImGui::Begin("Debug")) {
     gl_window_.DebugUI();
+    material_table_.DebugUI();
+    texture_streamer_.DebugUI();
+    GpuProfiler::Get().DebugUI();
+    if (simulation_ != nullptr) {
+      simulation_->DebugUI();
+      if constexpr (kIsInterpolatable<SimState>) {
+        ImGui::Text("Render delay: %.3f ms",
+                    1e-3f * static_cast<float>(render_delay_.count()));
+      }
+    }
     ImGui::Separator();
     static_cast<WindowImpl *>(this)->DebugUI(gl_window_);
     ImGui::End();
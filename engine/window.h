@@ -3,21 +3,60 @@
 #include "engine/core/gl_core.h"
 #include "engine/core/gl_window.h"
 #include "engine/core/input.h"
+#include "engine/core/input_recording.h"
+#include "engine/core/simulation_loop.h"
+#include "engine/materials/material_table.h"
+#include "engine/textures/texture_streamer.h"
 #include "util/imgui/imgui_util.h"
 #include "util/imgui/imgui_window.h"
 #include "util/macros.h"
 #include "util/report/report.h"
 
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+
 static constexpr glm::vec4 kDefaultClearColor =
     glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
 namespace gib {
 
+// Default simulation state for windows that tick everything on the render
+// thread.
+struct NoSimulationState {};
+
 // Owns OS window and drives render loop.
-template <typename WindowImpl> class WindowBase {
+//
+// WindowImpl implements:
+//   void Tick(const FrameTick &, GlfwWindow &);
+//   void Tock(const FrameTick &, GlfwWindow &);
+//   void DebugUI(GlfwWindow &);
+//
+// When a SimState is given, Tick() is replaced by:
+//   void SimTick(const FrameTick &, const Input &, SimState &);
+//   void Tick(const FrameTick &, GlfwWindow &, const SimState &);
+// SimTick() advances the game state and Tick() renders it. Once
+// EnableSimulationThread() is called, SimTick() runs on a dedicated thread at a
+// fixed rate and Tick() draws the newest published snapshot, so simulation
+// jitter no longer depends on render frame time. If SimState has an
+//   SimState Interpolate(const SimState &, const SimState &, float alpha);
+// overload, Tick() instead draws the state interpolated at
+// `now - render delay`, which keeps motion smooth when rendering faster than
+// the simulation rate.
+template <typename WindowImpl, typename SimState = NoSimulationState>
+class WindowBase {
 public:
-  explicit WindowBase(const std::string name)
-      : gl_core_(std::make_shared<GLCore>()), gl_window_(gl_core_, name),
+  // With GlfwWindowBackend::HEADLESS the loop runs without a display, e.g. for
+  // frame-time benchmarks and golden-frame tests on CI. GL_4_6 opts into a
+  // 4.6 context, e.g. for multi-draw-indirect RenderQueues.
+  explicit WindowBase(
+      const std::string name,
+      const GlfwWindowBackend backend = GlfwWindowBackend::WINDOWED,
+      const GlContextVersion gl_version = GlContextVersion::GL_4_1)
+      : gl_core_(std::make_shared<GLCore>()),
+        gl_window_(gl_core_, name, backend, gl_version),
         imgui_window_(gl_window_.GetGlfwWindowPtr()) {
     // Allow us to refer to this WindowImpl object while accessing C APIs.
     glfwSetWindowUserPointer(gl_window_.GetGlfwWindowPtr(), this);
@@ -40,6 +79,36 @@ public:
 
   [[nodiscard]] const Input &GetInput() const { return input_; }
 
+  // Moves SimTick() to a dedicated thread ticking at `rate_hz`, started by
+  // Run(). Must be called before Run(). `initial_state` seeds the simulation.
+  void EnableSimulationThread(const float rate_hz = kDefaultSimulationRateHz,
+                              const SimState &initial_state = SimState{});
+
+  // How far behind the wall clock interpolated snapshots are rendered. Must be
+  // at least one simulation tick (the default) so there are always two
+  // snapshots to interpolate between.
+  void SetRenderDelay(const time_util::DurationUsec render_delay);
+
+  // Records every frame's FrameTick and input events to `path`. Must be called
+  // before Run().
+  void RecordInput(const std::string &path);
+
+  // Replays a file written by RecordInput() in place of live input, so runs
+  // are reproducible, e.g. to compare frame-time percentiles between commits.
+  // With `fixed_dt`, WindowImpl is ticked with exactly that dt per frame
+  // instead of the recorded one. Frame timing stats still measure the real
+  // frame times. A simulation thread follows the replay clock in lockstep
+  // with the render loop rather than the wall clock. Run() returns when the
+  // recording ends. Must be called before Run().
+  void ReplayInput(
+      const std::string &path,
+      const std::optional<time_util::DurationUsec> fixed_dt = std::nullopt);
+
+  // Exports frame-time percentiles as JSON to `path` when the window closes.
+  void SetFrameStatsExportPath(const std::string &path) {
+    gl_window_.SetFrameStatsExportPath(path);
+  }
+
   // Enter the main loop. This call blocks until the user closes the window or
   // the application requests shutdown (glfwSetWindowShouldClose()).
   void Run();
@@ -58,12 +127,27 @@ public:
   WindowContext ctx_;
 
 private:
+  static constexpr bool kHasSimulation =
+      !std::is_same_v<SimState, NoSimulationState>;
+
   void DebugUI();
 
+  // Runs the simulation and calls WindowImpl::Tick() for this frame.
+  void TickImpl(const FrameTick &tick);
+
   void KeyCallback(int key, int scancode, int action, int mods);
   void MouseButtonCallback(int button, int action, int mods);
   void ScrollCallback(double xoffset, double yoffset);
   void MouseMoveCallback(double xpos, double ypos);
+  // Handles an input event from a GLFW callback. Dropped while replaying, so
+  // live ESC and LMB presses do not change the replayed capture state.
+  void QueueInputEvent(const InputEvent &event);
+  // Applies an input event, live or replayed, and forwards it to the
+  // simulation thread.
+  void ApplyInputEvent(const InputEvent &event);
+  // Applies the ESC and LMB behaviors. While replaying, only the capture
+  // state changes; the OS cursor and window close are left alone.
+  void HandleCaptureInput(const InputEvent &event);
 
   Input input_{};
   MouseButtonBehavior mouse_button_behavior_{};
@@ -71,8 +155,27 @@ private:
 
   std::shared_ptr<GLCore> gl_core_;
   GlfwWindow gl_window_;
+  // Need the window's context and UniformRing, so they are created after and
+  // destroyed before gl_window_.
+  MaterialTable material_table_;
+  TextureStreamer texture_streamer_;
   time_util::TimePoint last_time_;
 
+  // Input recording and replay, created by Run().
+  std::string record_input_path_;
+  std::string replay_input_path_;
+  std::optional<time_util::DurationUsec> replay_fixed_dt_;
+  std::unique_ptr<InputRecorder> input_recorder_;
+  std::unique_ptr<InputReplayer> input_replayer_;
+
+  // Simulation state ticked on the render thread when no simulation thread is
+  // running, the initial state of the simulation thread otherwise.
+  SimState sim_state_{};
+  std::unique_ptr<SimulationLoop<SimState>> simulation_;
+  // Interpolated snapshot drawn by the render thread.
+  SimState render_state_{};
+  time_util::DurationUsec render_delay_{0};
+
   imgui_util::ImGuiWindow imgui_window_;
   glm::vec4 clear_color_ = kDefaultClearColor;
 };
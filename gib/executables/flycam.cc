@@ -1,9 +1,11 @@
 #include "engine/core/frame_util.h"
 #include "engine/core/gl_window.h"
 #include "engine/core/types.h"
+#include "engine/shaders/program_cache.h"
 #include "engine/shaders/shader.h"
 #include "engine/vertex_util/vertex_array.h"
 
+#include "gib/executables/flycam_shaders.h"
 #include "gib/window.h"
 
 #include "third_party/glm/ext/matrix_clip_space.hpp"
@@ -13,6 +15,7 @@
 #include "engine/camera/camera_base.h"
 #include "engine/camera/fly_camera.h"
 #include "engine/core/input.h"
+#include "third_party/concise_args/ConciseArgs.h"
 #include "util/time/time.h"
 #include <OpenGL/OpenGL.h>
 
@@ -35,43 +38,11 @@ static const FloorVertex floor_vertices[] = {
     {{5.f, 0.f, 5.f}, {0.3f, 0.3f, 0.3f}, {1.0f, 1.0f}},
     {{-5.f, 0.f, 5.f}, {0.3f, 0.3f, 0.3f}, {0.0f, 1.0f}}};
 
-static const char *vertex_shader_src = R"GLSL(
-#version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
-layout (location = 2) in vec2 aTexCoord;
-
-uniform mat4 MVP;
-
-out vec3 ourColor;
-out vec2 TexCoord;
-
-void main()
-{
-	gl_Position = MVP * vec4(aPos, 1.0);
-	ourColor = aColor;
-	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-}
-)GLSL";
-
-static const char *fragment_shader_src = R"GLSL(
-#version 330 core
-out vec4 FragColor;
-
-in vec3 ourColor;
-in vec2 TexCoord;
-
-// texture sampler
-uniform sampler2D texture1;
-
-void main()
-{
-	FragColor = texture(texture1, TexCoord);
-}
-)GLSL";
-
 namespace gib {
 
+// Linked program binaries, reused across runs.
+static constexpr const char *kShaderCacheDir = ".cache/shaders";
+
 class FlyCamDemo final : public WindowBase<FlyCamDemo> {
 public:
   FlyCamDemo() : WindowBase("FlyCam Demo"), camera_(glm::vec3(0.f, 2.f, 5.f)) {
@@ -85,10 +56,8 @@ public:
     SetMouseButtonBehavior(MouseButtonBehavior::NONE);
     SetEscKeyBehavior(EscBehavior::TOGGLE_MOUSE_CAPTURE);
 
-    // Build shader
-    ShaderSource vs(vertex_shader_src, ShaderType::VERTEX, false);
-    ShaderSource fs(fragment_shader_src, ShaderType::FRAGMENT, false);
-    Shader shader{vs, fs};
+    // Build shader, validated and embedded at build time.
+    Shader shader{ShaderSource(kFlycamVert), ShaderSource(kFlycamFrag)};
     shader.Link();
     program_ = shader.GetProgramId();
     mvp_loc_ = glGetUniformLocation(program_, "MVP");
@@ -105,9 +74,9 @@ public:
     // load and create a texture
     // -------------------------
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D,
-                  texture); // all upcoming GL_TEXTURE_2D operations now have
-                            // effect on this texture object
+    // All upcoming GL_TEXTURE_2D operations now have effect on this texture
+    // object. Bound through GLCore so its state cache stays in sync.
+    GLCore::Current().BindTexture(GL_TEXTURE_2D, texture);
     // set the texture wrapping parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
                     GL_REPEAT); // set texture wrapping to GL_REPEAT (default
@@ -146,21 +115,27 @@ public:
     glm::mat4 model = glm::identity<glm::mat4>();
     glm::mat4 mvp = proj * view * model;
 
-    // bind Texture
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // Binds go through GLCore, raw GL calls would leave its cache stale.
+    GLCore &gl_core = window.GetGLCore();
+    gl_core.BindTexture(GL_TEXTURE_2D, texture);
 
-    glUseProgram(program_);
+    gl_core.UseProgram(program_);
     glUniformMatrix4fv(mvp_loc_, 1, GL_FALSE, glm::value_ptr(mvp));
 
-    glBindVertexArray(floor_vao_);
+    gl_core.BindVertexArray(floor_vao_);
     glDrawArrays(GL_TRIANGLES, 0, 6);
   }
 
   void Tock(const struct FrameTick &tick, GlfwWindow &window) {}
 
-  void DebugUI(GlfwWindow &window) { camera_.DebugUI(); }
+  void DebugUI(GlfwWindow &window) {
+    camera_.DebugUI();
+    program_cache_.DebugUI();
+  }
 
 private:
+  // Must be constructed before the shaders are built.
+  ProgramBinaryCache program_cache_{kShaderCacheDir};
   unsigned int texture;
 
   /*================ Input Handling ================*/
@@ -222,7 +197,34 @@ private:
 } // namespace gib
 
 int main(int argc, char **argv) {
+  std::string record_input;
+  std::string replay_input;
+  float fixed_dt_ms = 0.f;
+  std::string frame_stats;
+  ConciseArgs args(argc, argv, "", "Fly camera demo.");
+  args.add(record_input, "r", "record_input", "Record input to this file.");
+  args.add(replay_input, "p", "replay_input",
+           "Replay input recorded with --record_input.");
+  args.add(fixed_dt_ms, "d", "fixed_dt_ms",
+           "Tick with this fixed dt while replaying, 0 for the recorded dt.");
+  args.add(frame_stats, "s", "frame_stats",
+           "Export frame-time percentiles as JSON to this file on exit.");
+  args.parse();
+
   gib::FlyCamDemo demo;
+  if (!record_input.empty()) {
+    demo.RecordInput(record_input);
+  }
+  if (!replay_input.empty()) {
+    std::optional<time_util::DurationUsec> fixed_dt;
+    if (fixed_dt_ms > 0.f) {
+      fixed_dt = time_util::seconds_to_usec(1e-3f * fixed_dt_ms);
+    }
+    demo.ReplayInput(replay_input, fixed_dt);
+  }
+  if (!frame_stats.empty()) {
+    demo.SetFrameStatsExportPath(frame_stats);
+  }
   demo.Run();
 
   return 0;
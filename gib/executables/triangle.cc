@@ -93,9 +93,10 @@ public:
     p = glm::ortho(-ratio, ratio, -1.f, 1.f, 1.f, -1.f);
 
     mvp = p * m;
-    glUseProgram(program);
+    GLCore &gl_core = window.GetGLCore();
+    gl_core.UseProgram(program);
     glUniformMatrix4fv(mvp_location, 1, GL_FALSE, glm::value_ptr(mvp));
-    glBindVertexArray(vertex_array_vbo);
+    gl_core.BindVertexArray(vertex_array_vbo);
     glDrawArrays(GL_TRIANGLES, 0, 3);
   }
 
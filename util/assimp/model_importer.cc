@@ -1,4 +1,7 @@
 #include "util/assimp/model_importer.h"
+
+#include <algorithm>
+
 #include "engine/textures/texture.h"
 #include "util/report/report.h"
 
@@ -52,7 +55,7 @@ gib::Mesh Model::ProcessMesh(aiMesh *mesh, const aiScene *scene) {
   // data to fill
   std::vector<gib::Vertex> vertices;
   std::vector<unsigned int> indices;
-  std::vector<gib::Texture> textures;
+  std::vector<std::shared_ptr<gib::Texture>> textures;
 
   for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
     gib::Vertex vertex;
@@ -117,32 +120,32 @@ gib::Mesh Model::ProcessMesh(aiMesh *mesh, const aiScene *scene) {
   // normal: texture_normalN
 
   // Diffuse maps
-  std::vector<gib::Texture> diffuse_maps =
+  std::vector<std::shared_ptr<gib::Texture>> diffuse_maps =
       LoadMaterialTextures(material, aiTextureType_DIFFUSE);
   textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
 
   // Specular maps
-  std::vector<gib::Texture> specular_maps =
+  std::vector<std::shared_ptr<gib::Texture>> specular_maps =
       LoadMaterialTextures(material, aiTextureType_SPECULAR);
   textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
 
   // Normal maps
-  std::vector<gib::Texture> normal_maps =
+  std::vector<std::shared_ptr<gib::Texture>> normal_maps =
       LoadMaterialTextures(material, aiTextureType_HEIGHT);
   textures.insert(textures.end(), normal_maps.begin(), normal_maps.end());
 
   // Height maps
-  std::vector<gib::Texture> height_maps =
+  std::vector<std::shared_ptr<gib::Texture>> height_maps =
       LoadMaterialTextures(material, aiTextureType_AMBIENT);
   textures.insert(textures.end(), height_maps.begin(), height_maps.end());
 
   return gib::Mesh(vertices, indices, textures);
 }
 
-std::vector<gib::Texture>
+std::vector<std::shared_ptr<gib::Texture>>
 Model::LoadMaterialTextures(aiMaterial *material,
                             aiTextureType ai_texture_type) {
-  std::vector<gib::Texture> textures;
+  std::vector<std::shared_ptr<gib::Texture>> textures;
   for (unsigned int texture_count = 0;
        texture_count < material->GetTextureCount(ai_texture_type);
        ++texture_count) {
@@ -150,10 +153,25 @@ Model::LoadMaterialTextures(aiMaterial *material,
     material->GetTexture(ai_texture_type, texture_count, &texture_path);
 
     const gib::TextureParams params{};
-    const gib::Texture texture = gib::Texture::Load2D(
-        fmt::format("{}/{}", directory_, texture_path.C_Str()), params);
+    const std::string path =
+        fmt::format("{}/{}", directory_, texture_path.C_Str());
+    const auto loaded =
+        std::find_if(textures_loaded_.begin(), textures_loaded_.end(),
+                     [&path](const std::shared_ptr<gib::Texture> &texture) {
+                       return texture->GetPath() == path;
+                     });
+    if (loaded != textures_loaded_.end()) {
+      textures.push_back(*loaded);
+      continue;
+    }
+    // Streamed if the window has a streamer, so the textures of a model
+    // decode in parallel instead of one after another.
+    gib::TextureStreamer *streamer = gib::TextureStreamer::Current();
+    auto texture = std::make_shared<gib::Texture>(
+        streamer != nullptr ? streamer->Request2D(path, params)
+                            : gib::Texture::Load2D(path, params));
     textures.push_back(texture);
-    textures_loaded_.push_back(texture);
+    textures_loaded_.push_back(std::move(texture));
   }
   return textures;
 }
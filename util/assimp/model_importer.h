@@ -3,6 +3,7 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -20,6 +21,7 @@
 
 #include "engine/mesh/mesh.h"
 #include "engine/textures/texture.h"
+#include "engine/textures/texture_streamer.h"
 #include "engine/textures/texture_utils.h"
 
 static constexpr int kMaxBoneInfulence = 4;
@@ -34,7 +36,8 @@ public:
   // Loads the model if not loaded.
   void LoadModel();
 
-  [[nodiscard]] std::vector<gib::Texture> GetLoadedTexture() const {
+  [[nodiscard]] const std::vector<std::shared_ptr<gib::Texture>> &
+  GetLoadedTexture() const {
     return textures_loaded_;
   }
 
@@ -53,12 +56,12 @@ private:
   void ProcessNode(aiNode *node, const aiScene *scene);
 
   // Checks all material textures of a given type and loads the textures if
-  // they're not loaded yet. the required info is returned as a TextureStruct
-  // struct.
-  std::vector<gib::Texture> LoadMaterialTextures(aiMaterial *material,
-                                                 aiTextureType ai_texture_type);
+  // they're not loaded yet. Textures are move-only, so meshes share the
+  // loaded ones.
+  std::vector<std::shared_ptr<gib::Texture>>
+  LoadMaterialTextures(aiMaterial *material, aiTextureType ai_texture_type);
 
-  std::vector<gib::Texture> textures_loaded_;
+  std::vector<std::shared_ptr<gib::Texture>> textures_loaded_;
   std::vector<gib::Mesh> meshes_;
 
   std::string path_;
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "util/time/time.h"
+
+namespace time_util {
+
+// Log-linear (HDR style) histogram of durations with microsecond resolution.
+//
+// Values below kSubBuckets usec are recorded exactly. Above that, every power
+// of two is split into kSubBuckets linear buckets, so any value is reported
+// within ~3% of the recorded one. Values above kMaxValueUsec (~67 s) are
+// clamped. Recording is a few bit operations and an increment, no allocation.
+class DurationHistogram {
+public:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kMaxValueBits = 26;
+  static constexpr uint64_t kMaxValueUsec = (uint64_t{1} << kMaxValueBits) - 1;
+  static constexpr int kNumBuckets =
+      kSubBuckets + (kMaxValueBits - kSubBucketBits) * kSubBuckets;
+
+  DurationHistogram() { Reset(); }
+
+  void Record(const DurationUsec duration) {
+    const uint64_t value = std::min<uint64_t>(
+        static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)),
+        kMaxValueUsec);
+    ++counts_[BucketIndex(value)];
+    ++total_count_;
+    min_usec_ = std::min(min_usec_, value);
+    max_usec_ = std::max(max_usec_, value);
+  }
+
+  void Reset() {
+    counts_.fill(0);
+    total_count_ = 0;
+    min_usec_ = kMaxValueUsec;
+    max_usec_ = 0;
+  }
+
+  [[nodiscard]] uint64_t Count() const { return total_count_; }
+  [[nodiscard]] DurationUsec Min() const {
+    return DurationUsec(total_count_ == 0 ? 0 : min_usec_);
+  }
+  [[nodiscard]] DurationUsec Max() const { return DurationUsec(max_usec_); }
+
+  // Smallest recorded value such that `percentile`% of the values are at or
+  // below it, e.g. Percentile(99.f) is p99. 0 if empty.
+  [[nodiscard]] DurationUsec Percentile(const float percentile) const {
+    if (total_count_ == 0) {
+      return DurationUsec(0);
+    }
+    const float clamped = std::clamp(percentile, 0.f, 100.f);
+    const uint64_t target = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(
+               static_cast<double>(clamped) / 100.0 *
+               static_cast<double>(total_count_))));
+    uint64_t cumulative = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      cumulative += counts_[i];
+      if (cumulative >= target) {
+        return DurationUsec(std::min(BucketUpperBound(i), max_usec_));
+      }
+    }
+    return DurationUsec(max_usec_);
+  }
+
+  // Number of values in [from, to).
+  [[nodiscard]] uint64_t CountBetween(const DurationUsec from,
+                                      const DurationUsec to) const {
+    uint64_t count = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      const uint64_t lower = BucketLowerBound(i);
+      if (lower >= static_cast<uint64_t>(from.count()) &&
+          lower < static_cast<uint64_t>(to.count())) {
+        count += counts_[i];
+      }
+    }
+    return count;
+  }
+
+private:
+  static int BucketIndex(const uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<int>(value);
+    }
+    const int magnitude = 63 - __builtin_clzll(value);
+    const int shift = magnitude - kSubBucketBits;
+    const int sub_bucket = static_cast<int>(value >> shift) - kSubBuckets;
+    return kSubBuckets + shift * kSubBuckets + sub_bucket;
+  }
+
+  static uint64_t BucketLowerBound(const int index) {
+    if (index < kSubBuckets) {
+      return static_cast<uint64_t>(index);
+    }
+    const int shift = (index - kSubBuckets) / kSubBuckets;
+    const int sub_bucket = (index - kSubBuckets) % kSubBuckets;
+    return static_cast<uint64_t>(kSubBuckets + sub_bucket) << shift;
+  }
+
+  static uint64_t BucketUpperBound(const int index) {
+    if (index < kSubBuckets) {
+      return static_cast<uint64_t>(index);
+    }
+    const int shift = (index - kSubBuckets) / kSubBuckets;
+    return BucketLowerBound(index) + (uint64_t{1} << shift) - 1;
+  }
+
+  std::array<uint32_t, kNumBuckets> counts_{};
+  uint64_t total_count_{0};
+  uint64_t min_usec_{kMaxValueUsec};
+  uint64_t max_usec_{0};
+};
+
+} // namespace time_util